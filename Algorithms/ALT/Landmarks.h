@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "DataStructures/Graph/Graph.h"
+#include "DataStructures/Queues/AddressableKHeap.h"
+#include "Tools/Workarounds.h"
+
+// A set of landmarks together with the distances between each landmark and each vertex, as used by
+// ALT (A*, landmarks and triangle inequality). The distances are computed with respect to per-edge
+// lower bounds on the edge weights. Hence, they yield lower bounds on the distances with respect to
+// any edge weights that are no smaller than these bounds, such as the weights in every iteration of
+// the Frank-Wolfe method when the bounds are the free-flow travel times.
+class Landmarks {
+public:
+	// Selects landmarks by the farthest heuristic and computes the distances between each landmark
+	// and each vertex with respect to the specified lower bounds.
+	void preprocess(const Graph& graph, const std::vector<EdgeValue>& lowerBounds, const int numLandmarks) {
+		assert(lowerBounds.size() == graph.numEdges());
+		assert(numLandmarks >= 0);
+		const int n = graph.numVertices();
+		numMarks = std::min(numLandmarks, n);
+		landmarks.clear();
+		distancesFrom.assign(static_cast<size_t>(n) * numMarks, use(INF));
+		distancesTo.assign(static_cast<size_t>(n) * numMarks, use(INF));
+		if (numMarks == 0)
+			return;
+
+		std::vector<double> forward(n);
+		std::vector<double> backward(n);
+		std::vector<double> minDistance(n, use(INF));
+
+		// The first landmark is the vertex farthest away from a random start vertex.
+		std::minstd_rand rand(n);
+		const int start = std::uniform_int_distribution<int>(0, n - 1)(rand);
+		computeDistances(graph, lowerBounds, start, true, forward);
+		int landmark = farthestVertex(graph, forward);
+
+		for (int l = 0; l < numMarks; ++l)
+		{
+			landmarks.push_back(landmark);
+			computeDistances(graph, lowerBounds, landmark, true, forward);
+			computeDistances(graph, lowerBounds, landmark, false, backward);
+			FORALL_VERTICES(graph, v)
+			{
+				distancesFrom[static_cast<size_t>(v) * numMarks + l] = forward[v];
+				distancesTo[static_cast<size_t>(v) * numMarks + l] = backward[v];
+				minDistance[v] = std::min(minDistance[v], forward[v] + backward[v]);
+			}
+
+			// Each subsequent landmark is the vertex farthest away from all previous ones.
+			landmark = farthestVertex(graph, minDistance);
+		}
+	}
+
+	// Recomputes the distances between the selected landmarks and each vertex with respect to the
+	// specified edge weights, which may differ from the ones used for selection.
+	void updateDistances(const Graph& graph, const std::vector<EdgeValue>& weights) {
+		assert(weights.size() == graph.numEdges());
+		std::vector<double> forward(graph.numVertices());
+		std::vector<double> backward(graph.numVertices());
+		for (int l = 0; l < numMarks; ++l)
+		{
+			computeDistances(graph, weights, landmarks[l], true, forward);
+			computeDistances(graph, weights, landmarks[l], false, backward);
+			FORALL_VERTICES(graph, v)
+			{
+				distancesFrom[static_cast<size_t>(v) * numMarks + l] = forward[v];
+				distancesTo[static_cast<size_t>(v) * numMarks + l] = backward[v];
+			}
+		}
+	}
+
+	// Returns lower bounds on the edge weights in every Frank-Wolfe iteration. The free-flow travel
+	// times bound the weights of road edges from below. The weights of the virtual edges
+	// representing the inverse demand function are only bounded by zero. The bounds are stored in
+	// the precision of the weights and rounded down, since a weight that is computed in double
+	// precision and rounded to the nearest EdgeValue may fall below the nearest bound.
+	static std::vector<EdgeValue> freeFlowLowerBounds(const Graph& graph) {
+		std::vector<EdgeValue> lowerBounds(graph.numEdges());
+		FORALL_EDGES(graph, e)
+		{
+			const double bound = graph.capacity(e) == 0 ? 0.0 : graph.freeTravelTime(e);
+			lowerBounds[e] = static_cast<EdgeValue>(bound);
+			if (lowerBounds[e] > bound)
+				lowerBounds[e] = std::nextafter(lowerBounds[e], EdgeValue{0});
+		}
+		return lowerBounds;
+	}
+
+	// Returns the number of landmarks.
+	int numLandmarks() const {
+		return numMarks;
+	}
+
+	// Returns the i-th landmark.
+	int landmark(const int i) const {
+		assert(i >= 0); assert(i < numMarks);
+		return landmarks[i];
+	}
+
+	// Returns a lower bound on the distance from v to t, which is infinity if t is unreachable.
+	double lowerBound(const int v, const int t) const {
+		const double* const fromV = &distancesFrom[0] + static_cast<size_t>(v) * numMarks;
+		const double* const fromT = &distancesFrom[0] + static_cast<size_t>(t) * numMarks;
+		const double* const toV = &distancesTo[0] + static_cast<size_t>(v) * numMarks;
+		const double* const toT = &distancesTo[0] + static_cast<size_t>(t) * numMarks;
+
+		double bound = 0;
+		for (int l = 0; l < numMarks; ++l)
+		{
+			// dist(v, t) >= dist(v, L) - dist(t, L)
+			if (toV[l] != INF || toT[l] != INF)
+				bound = std::max(bound, toV[l] - toT[l]);
+			// dist(v, t) >= dist(L, t) - dist(L, v)
+			if (fromT[l] != INF || fromV[l] != INF)
+				bound = std::max(bound, fromT[l] - fromV[l]);
+		}
+		return bound;
+	}
+
+	static constexpr double INF = std::numeric_limits<double>::infinity();
+
+private:
+	// Computes the distances from (or to, if forward is false) the source with respect to the
+	// specified lower bounds, which may be stored in single or double precision.
+	template <typename WeightT>
+	static void computeDistances(const Graph& graph, const std::vector<WeightT>& lowerBounds,
+								 const int source, const bool forward, std::vector<double>& dist) {
+		AddressableKHeap<4, double> queue(graph.numVertices());
+		std::fill(dist.begin(), dist.end(), use(INF));
+		dist[source] = 0;
+		queue.insert(source, 0);
+		while (!queue.empty())
+		{
+			int u;
+			double distToU;
+			queue.deleteMin(u, distToU);
+			const auto edges = forward ? graph.outgoingEdges(u) : graph.incomingEdges(u);
+			for (const int e : edges)
+			{
+				const int v = forward ? graph.head(e) : graph.tail(e);
+				const double distToV = distToU + lowerBounds[e];
+				if (distToV < dist[v])
+				{
+					dist[v] = distToV;
+					if (queue.contains(v))
+						queue.decreaseKey(v, distToV);
+					else
+						queue.insert(v, distToV);
+				}
+			}
+		}
+	}
+
+	// Returns the vertex (with at least one incident edge) having the largest specified distance.
+	// Unreachable vertices are preferred, so that every connected component obtains a landmark.
+	static int farthestVertex(const Graph& graph, const std::vector<double>& dist) {
+		int farthest = 0;
+		double maxDistance = -1;
+		FORALL_VERTICES(graph, v)
+			if (dist[v] > maxDistance && (graph.outgoingEdges(v).size() > 0 || graph.incomingEdges(v).size() > 0))
+			{
+				farthest = v;
+				maxDistance = dist[v];
+			}
+		return farthest;
+	}
+
+	int numMarks = 0;                  // The number of landmarks.
+	std::vector<int> landmarks;        // The IDs of the landmark vertices.
+	std::vector<double> distancesFrom; // distancesFrom[v * k + l] is the distance from landmark l to v.
+	std::vector<double> distancesTo;   // distancesTo[v * k + l] is the distance from v to landmark l.
+};
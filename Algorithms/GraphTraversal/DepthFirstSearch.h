@@ -4,8 +4,6 @@
 #include <stack>
 #include <vector>
 
-#include "DataStructures/Graph/Graph.h"
-
 // Non-recursive implementation of depth-first search. This class is an algorithm template.
 // Concrete DFS-based algorithms (like computing a DFS numbering or strongly connected components)
 // are derived from it by implementing various hook functions called during execution of the DFS.
@@ -36,7 +34,7 @@ class DepthFirstSearch {
   void run(const GraphT& graph) {
     concreteAlgo.unmarkVertices(graph.numVertices());
     concreteAlgo.init();
-    FORALL_VERTICES(graph, s)
+    for (int s = 0; s < graph.numVertices(); ++s)
       if (!concreteAlgo.hasBeenReached(s))
         growDfsTree(graph, s);
   }
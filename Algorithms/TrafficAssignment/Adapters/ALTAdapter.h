@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include "Algorithms/ALT/Landmarks.h"
+#include "DataStructures/Graph/Graph.h"
+#include "DataStructures/Queues/AddressableKHeap.h"
+#include "Tools/Constants.h"
+
+// A goal-directed point-to-point search (A* with landmark potentials), intended for scattered
+// one-to-one queries such as the destination-to-rebalancer queries in the elastic AMoD setting.
+// The landmark distances are computed once on the free-flow travel times, which are lower bounds
+// on the edge weights in every Frank-Wolfe iteration, and are combined with the current weights.
+class ALTAdapter {
+public:
+	// The free-flow lower bounds and the landmarks, which do not depend on the current weights and
+	// are shared by all instances working on the same input graph.
+	class Preprocessing {
+	public:
+		explicit Preprocessing(const Graph& graph) : lowerBounds(Landmarks::freeFlowLowerBounds(graph)) {
+			landmarks.preprocess(graph, lowerBounds, graph.numLandmarks());
+		}
+
+		std::vector<EdgeValue> lowerBounds; // The lower bounds on the edge weights.
+		Landmarks landmarks;                // The landmarks and their distances to all vertices.
+	};
+
+	// Constructs a query algorithm instance working on the specified weights and preprocessing data.
+	ALTAdapter(const Graph& graph, const std::vector<EdgeValue>& weights, const Preprocessing& preprocessing)
+		: graph(graph),
+		  weights(weights),
+		  lowerBounds(preprocessing.lowerBounds),
+		  landmarks(preprocessing.landmarks),
+		  queue(graph.numVertices()),
+		  distance(graph.numVertices()),
+		  potential(graph.numVertices()),
+		  parentEdge(graph.numVertices()),
+		  visited(graph.numVertices(), 0),
+		  currentRound(0),
+		  usePotentials(true),
+		  numCustomizationsWithoutPotentials(0) { }
+
+	// Computes a shortest path from source to target.
+	double run(const int source, const int target, std::list<int>& path) {
+		path.clear();
+		if (source == target)
+			return 0;
+
+		++currentRound;
+		queue.clear();
+		visit(source, target);
+		if (potential[source] == Landmarks::INF)
+			return Landmarks::INF;
+		distance[source] = 0;
+		queue.insert(source, potential[source]);
+
+		while (!queue.empty())
+		{
+			int u;
+			double key;
+			queue.deleteMin(u, key);
+			if (u == target)
+				break;
+
+			FORALL_OUTGOING_EDGES(graph, u, e)
+			{
+				const int v = graph.head(e);
+				visit(v, target);
+				if (potential[v] == Landmarks::INF)
+					continue; // target unreachable from v
+
+				const double distToV = distance[u] + weights[e];
+				if (distToV < distance[v])
+				{
+					distance[v] = distToV;
+					parentEdge[v] = e;
+					if (queue.contains(v))
+						queue.decreaseKey(v, distToV + potential[v]);
+					else
+						queue.insert(v, distToV + potential[v]);
+				}
+			}
+		}
+
+		if (visited[target] != currentRound || distance[target] == Landmarks::INF)
+			return Landmarks::INF; // graph not connected
+
+		for (int v = target; v != source; v = graph.tail(parentEdge[v]))
+			path.push_front(parentEdge[v]);
+		return distance[target];
+	}
+
+	void customize() {
+		// The bounds are rounded down to the precision of the weights, so no weight should drop
+		// below its bound. If one does anyway, fall back to plain Dijkstra and report it.
+		int numEdgesBelowBound = 0;
+		FORALL_EDGES(graph, e)
+			if (weights[e] < lowerBounds[e])
+				++numEdgesBelowBound;
+		usePotentials = numEdgesBelowBound == 0;
+		if (!usePotentials)
+		{
+			++numCustomizationsWithoutPotentials;
+			std::cerr << "ALT: " << numEdgesBelowBound << " edge weights below their lower bounds, ";
+			std::cerr << "landmark potentials disabled (" << numCustomizationsWithoutPotentials << " times so far)" << std::endl;
+		}
+	}
+
+private:
+	// Initializes the label of v in the current search, if this is the first time v is reached.
+	void visit(const int v, const int target) {
+		if (visited[v] == currentRound)
+			return;
+		visited[v] = currentRound;
+		distance[v] = Landmarks::INF;
+		potential[v] = usePotentials ? landmarks.lowerBound(v, target) : 0;
+		parentEdge[v] = INVALID_EDGE;
+	}
+
+	const Graph& graph;                        // The input graph.
+	const std::vector<EdgeValue>& weights;     // The current edge weights.
+	const std::vector<EdgeValue>& lowerBounds; // The lower bounds on the edge weights.
+	const Landmarks& landmarks;                // The landmarks and their distances to all vertices.
+	AddressableKHeap<4, double> queue;         // The priority queue of the A* search.
+	std::vector<double> distance;              // The tentative distance of each vertex.
+	std::vector<double> potential;             // The potential of each vertex w.r.t. the current target.
+	std::vector<int> parentEdge;               // The edge on which each vertex was reached.
+	std::vector<int> visited;                  // The round in which each vertex was reached last.
+	int currentRound;                          // The current round (i.e., the number of queries so far).
+	bool usePotentials;                        // Are the landmark potentials valid for the current weights?
+	int numCustomizationsWithoutPotentials;    // The number of times the potentials had to be disabled.
+};
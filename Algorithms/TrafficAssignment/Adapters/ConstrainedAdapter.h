@@ -105,8 +105,31 @@ public:
 // The search algorithm using the graph and possibly auxiliary data to compute shortest paths.
 class ConstrainedAdapter {
 public:
-	// Constructs a query algorithm instance working on the specified data.
-	explicit ConstrainedAdapter(Graph& graph) : graph(graph), weights(graph.getWeights()), lengthMap(edgeLengths, lemonGraph), dijkstra(lemonGraph, lengthMap), normalDistanceMultiplier(graph.noramlDistanceMultiplier()) { }
+	using LemonGraph = StaticDigraph;
+
+	// The LEMON graph for computing normal distances and its arc lengths, which do not depend on the
+	// edge weights and are shared by all instances working on the same input graph. LEMON requires
+	// the arcs to be sorted by tail, so the lengths are stored per arc.
+	class Preprocessing {
+	public:
+		explicit Preprocessing(const Graph& graph) {
+			std::vector<std::pair<int,int>> edges;
+			edges.reserve(graph.numEdges());
+			FORALL_VERTICES(graph, u)
+				FORALL_OUTGOING_EDGES(graph, u, e){
+					edges.emplace_back(u, graph.head(e));
+					edgeLengths.push_back(graph.length(e));
+				}
+
+			lemonGraph.build(graph.numVertices(), edges.begin(), edges.end());
+		}
+
+		LemonGraph lemonGraph;           // Graph for computing the normal distance
+		std::vector<double> edgeLengths; // The length of each arc
+	};
+
+	// Constructs a query algorithm instance working on the specified weights and preprocessing data.
+	ConstrainedAdapter(const Graph& graph, const std::vector<EdgeValue>& weights, const Preprocessing& preprocessing) : graph(graph), weights(weights), lemonGraph(preprocessing.lemonGraph), lengthMap(preprocessing.edgeLengths, lemonGraph), dijkstra(lemonGraph, lengthMap), normalDistanceMultiplier(graph.noramlDistanceMultiplier()) { }
 	
 	
 	// Computes shortest paths from source to target
@@ -169,20 +192,6 @@ public:
 		return 0;
 	}
 	
-	void preprocess(){
-		// prepare distances map
-		std::vector<std::pair<int,int>> edges(graph.numEdges());
-		edgeLengths = std::vector<double>(graph.numEdges());
-		
-		for (int e = 0; e < graph.numEdges(); ++e){
-			edges[e] = std::make_pair(graph.tail(e), graph.head(e));
-			edgeLengths[e] = graph.length(e);
-		}
-		
-		lemonGraph.build(graph.numVertices(), edges.begin(), edges.end());
-		dijkstra = Dijkstra<LemonGraph, LengthMap>(lemonGraph, lengthMap);
-	}
-
 	void customize(){
 		// construct the boost graph
 		boostGraph.clear();
@@ -199,7 +208,6 @@ public:
 	}
 	
 private:
-	using LemonGraph = StaticDigraph;
 	using Node = LemonGraph::Node;
 	using Arc = LemonGraph::Arc;
 	using NodeIt = LemonGraph::NodeIt;
@@ -214,27 +222,26 @@ private:
 	struct LengthMap 
 	{
 		typedef double Value;
-		LengthMap(std::vector<double>& lengths, LemonGraph& lg) : lengths(lengths), lg(lg) { }
+		LengthMap(const std::vector<double>& lengths, const LemonGraph& lg) : lengths(lengths), lg(lg) { }
 		
 		double operator[](Arc e) const
 		{
 			return lengths[lg.index(e)];
 		}
 
-		std::vector<double>& lengths;
-		LemonGraph& lg;
+		const std::vector<double>& lengths;
+		const LemonGraph& lg;
 	};
 
-	Graph& graph;									// Input graph
-	std::vector<double>& weights;					// Specifies edge travel time for search
+	const Graph& graph;								// Input graph
+	const std::vector<EdgeValue>& weights;			// Specifies edge travel time for search
 	std::map<std::pair<int,int>,double> distances;	// Specifies normal distances used as constraints
 	BoostGraph boostGraph;							// Graph for constrained search
-	LemonGraph lemonGraph;							// Graph for computing the normal distance
+	const LemonGraph& lemonGraph;					// Graph for computing the normal distance
 	LengthMap lengthMap;
 	Dijkstra<LemonGraph, LengthMap> dijkstra;		// Dijkstra search for normal distance
 	std::map<std::pair<int,int>,int> edge_map;		// Maps from pair edges to edge index
 	double normalDistanceMultiplier;
 	std::vector<double> boost_vertices;
-	std::vector<double> edgeLengths;
 	
 };
@@ -13,9 +13,34 @@ using namespace lemon;
 // The search algorithm using the graph and possibly auxiliary data to compute shortest paths.
 class DijkstraAdapter {
 public:
-	// Constructs a query algorithm instance working on the specified data.
-	explicit DijkstraAdapter(Graph& graph) : graph(graph), weightMap(graph.getWeights(), lemonGraph),
-											 dijkstra(lemonGraph, weightMap){ }
+	using LemonGraph = StaticDigraph;
+
+	// The LEMON graph, which does not depend on the edge weights and is shared by all instances
+	// working on the same input graph. LEMON requires the arcs to be sorted by tail. The edges of the
+	// input graph need not be (demand edges come last), so arcs are mapped back to edges.
+	class Preprocessing {
+	public:
+		explicit Preprocessing(const Graph& graph) {
+			std::vector<std::pair<int,int>> edges;
+			edges.reserve(graph.numEdges());
+			FORALL_VERTICES(graph, u)
+				FORALL_OUTGOING_EDGES(graph, u, e)
+				{
+					edges.emplace_back(u, graph.head(e));
+					arcEdge.push_back(e);
+				}
+
+			lemonGraph.build(graph.numVertices(), edges.begin(), edges.end());
+		}
+
+		LemonGraph lemonGraph;    // The graph used for dijkstra search
+		std::vector<int> arcEdge; // The edge of the input graph corresponding to each arc
+	};
+
+	// Constructs a query algorithm instance working on the specified weights and preprocessing data.
+	DijkstraAdapter(const Graph& /*graph*/, const std::vector<EdgeValue>& weights, const Preprocessing& preprocessing)
+		: lemonGraph(preprocessing.lemonGraph), arcEdge(preprocessing.arcEdge), weightMap(weights, arcEdge, lemonGraph),
+		  dijkstra(lemonGraph, weightMap) { }
 
 	// Computes shortest paths from each source to its target simultaneously.
 	double run(const int source, const int target, std::list<int>& path) {
@@ -40,7 +65,7 @@ public:
 		{
 			Arc in_arc =  dijkstra.predMap()[node];
 			node = lemonGraph.source(in_arc);
-			path.push_front(lemonGraph.id(in_arc));
+			path.push_front(arcEdge[lemonGraph.id(in_arc)]);
 		}
 
 		return dijkstra.dist(t);
@@ -48,14 +73,6 @@ public:
 		//assert(!path.empty()); // Graph not connected!
 	}
 
-	void preprocess(){
-		std::vector<std::pair<int,int>> edges(graph.numEdges());
-		for (int e = 0; e < graph.numEdges(); ++e)
-			edges[e] = std::make_pair(graph.tail(e), graph.head(e));
-		
-		lemonGraph.build(graph.numVertices(), edges.begin(), edges.end());
-	}
-
 	void customize(){
 		dijkstra.lengthMap(weightMap);
 		currentSource = 0;
@@ -63,7 +80,6 @@ public:
 	}	
 	
 private:
-	using LemonGraph = StaticDigraph;
 	using Node = LemonGraph::Node;
 	using Arc = LemonGraph::Arc;
 	using NodeIt = LemonGraph::NodeIt;
@@ -78,19 +94,20 @@ private:
 	struct WeightMap 
 	{
 		typedef double Value;
-		WeightMap(std::vector<double>& weights, LemonGraph& lg) : weights(weights), lg(lg) { }
+		WeightMap(const std::vector<EdgeValue>& weights, const std::vector<int>& arcEdge, const LemonGraph& lg) : weights(weights), arcEdge(arcEdge), lg(lg) { }
 		
 		double operator[](Arc e) const
 			{
-				return weights[lg.index(e)];
+				return weights[arcEdge[lg.index(e)]];
 			}
 
-		std::vector<double>& weights;
-		LemonGraph& lg;
+		const std::vector<EdgeValue>& weights;
+		const std::vector<int>& arcEdge;
+		const LemonGraph& lg;
 	};
 	
-	Graph& graph;           // The input graph.
-	LemonGraph lemonGraph;  // The graph used for dijkstra search
+	const LemonGraph& lemonGraph; // The graph used for dijkstra search
+	const std::vector<int>& arcEdge; // The edge of the input graph corresponding to each arc
 	WeightMap weightMap;	// Specifies edge weights for Dijkstra search
 	Dijkstra<LemonGraph, WeightMap> dijkstra; // Dijkstra search
 	int currentSource;
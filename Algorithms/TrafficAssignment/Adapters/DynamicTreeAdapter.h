@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <vector>
+
+#include "DataStructures/Graph/Graph.h"
+#include "DataStructures/Queues/AddressableKHeap.h"
+#include "Tools/Constants.h"
+#include "Tools/Timer.h"
+#include "Tools/Workarounds.h"
+
+// A one-to-all search that keeps the shortest-path tree of each origin between iterations and
+// repairs it when the edge weights change, rather than rebuilding it from scratch. A tree is stored
+// compactly as the parent edge of each vertex. To repair a tree, the distances along the old tree
+// are recomputed under the new weights, every edge violating the triangle inequality seeds a
+// Dijkstra-like search, and only the vertices whose distances improve are rescanned. For a tree
+// from the last iteration, only the edges that became cheaper, the incoming edges of vertices below
+// tree edges that became more expensive, and the outgoing edges of vertices below tree edges that
+// became cheaper can violate the inequality, so only these are checked if they are few. Since
+// Frank-Wolfe changes the weight of every loaded edge, repairs may cost more than they save under
+// heavy demand. Hence, both options are timed on a sample of the trees, and trees are rebuilt from
+// scratch in the next iteration if that was faster. The total memory for stored trees is capped;
+// origins beyond the cap are recomputed from scratch.
+class DynamicTreeAdapter {
+public:
+	// The trees depend on the weights, so there is nothing to share between instances.
+	class Preprocessing {
+	public:
+		explicit Preprocessing(const Graph& /*graph*/) { }
+	};
+
+	// Constructs a query algorithm instance working on the specified weights.
+	DynamicTreeAdapter(const Graph& graph, const std::vector<EdgeValue>& weights, const Preprocessing& /*preprocessing*/)
+		: graph(graph),
+		  weights(weights),
+		  queue(graph.numVertices()),
+		  distance(graph.numVertices()),
+		  parentEdge(graph.numVertices()),
+		  storedTrees(graph.numVertices()),
+		  maxStoredTrees(int64_t{graph.treeMemoryLimit()} * 1024 * 1024 / (sizeof(int32_t) * std::max(graph.numVertices(), 1))),
+		  numStoredTrees(0),
+		  treeIteration(graph.numVertices(), -1),
+		  currentSource(INVALID_VERTEX),
+		  currentIteration(0),
+		  weightChange(graph.numEdges(), 0),
+		  pathChange(graph.numVertices()),
+		  repairTrees(true) { }
+
+	// Computes a shortest path from source to target, using the tree of source.
+	double run(const int source, const int target, std::list<int>& path) {
+		path.clear();
+		if (source != currentSource)
+		{
+			currentSource = source;
+			computeTree(source);
+		}
+
+		if (distance[target] == INF)
+			return INF; // graph not connected
+
+		for (int v = target; v != source; v = graph.tail(parentEdge[v]))
+			path.push_front(parentEdge[v]);
+		return distance[target];
+	}
+
+	void customize() {
+		// The weights have changed, so the tree of the current source has to be repaired.
+		currentSource = INVALID_VERTEX;
+		++currentIteration;
+		decreasedEdges.clear();
+		if (previousWeights.empty())
+		{
+			previousWeights.assign(weights.begin(), weights.end());
+			return;
+		}
+		int numChangedEdges = 0;
+		FORALL_EDGES(graph, e)
+		{
+			weightChange[e] = (weights[e] > previousWeights[e]) - (weights[e] < previousWeights[e]);
+			numChangedEdges += weightChange[e] != 0;
+			if (weightChange[e] < 0)
+				decreasedEdges.push_back(e);
+			previousWeights[e] = weights[e];
+		}
+		// If many weights changed, most vertices have changes on their tree paths, and recording
+		// them does not pay off.
+		trackChanges = numChangedEdges < graph.numEdges() / MIN_UNCHANGED_RATIO;
+
+		// Repair the trees in this iteration if that was faster on the sampled trees of the last one.
+		if (sampleTime[false] > 0 && sampleTime[true] > 0)
+			repairTrees = sampleTime[true] <= sampleTime[false];
+		sampleTime[false] = 0;
+		sampleTime[true] = 0;
+	}
+
+private:
+	// Computes the shortest-path tree of source, either by repairing its stored tree or from scratch.
+	void computeTree(const int source) {
+		std::vector<int32_t>& tree = storedTrees[source];
+		if (!tree.empty() && ++numTreesSinceSample == SAMPLE_INTERVAL)
+		{
+			// Measure both options on this tree, the chosen one last.
+			numTreesSinceSample = 0;
+			for (const bool repair : {!repairTrees, repairTrees})
+			{
+				Timer timer;
+				computeTree(source, repair);
+				sampleTime[repair] += timer.elapsed<std::chrono::nanoseconds>();
+			}
+		}
+		else
+		{
+			computeTree(source, repairTrees && !tree.empty());
+		}
+
+		if (!tree.empty() || numStoredTrees < maxStoredTrees)
+		{
+			numStoredTrees += tree.empty();
+			tree.assign(parentEdge.begin(), parentEdge.end());
+			treeIteration[source] = currentIteration;
+		}
+	}
+
+	// Computes the shortest-path tree of source by repairing its stored tree or from scratch.
+	void computeTree(const int source, const bool repair) {
+		if (repair)
+		{
+			parentEdge.assign(storedTrees[source].begin(), storedTrees[source].end());
+			repairTree(source, trackChanges && treeIteration[source] == currentIteration - 1);
+		}
+		else
+		{
+			runDijkstra(source);
+		}
+	}
+
+	// Computes the shortest-path tree of source from scratch.
+	void runDijkstra(const int source) {
+		std::fill(distance.begin(), distance.end(), use(INF));
+		std::fill(parentEdge.begin(), parentEdge.end(), INVALID_EDGE);
+		queue.clear();
+		distance[source] = 0;
+		queue.insert(source, 0);
+		settleQueue();
+	}
+
+	// Repairs the tree given by parentEdge, which was a shortest-path tree of source under the
+	// weights of an earlier iteration. If fromChanges is set, it was the last iteration and only
+	// the edges affected by the weight changes since are checked (if they are few).
+	void repairTree(const int source, const bool fromChanges) {
+		// Compute the distances along the old tree under the current weights. Each is the length of
+		// an actual path, and thus an upper bound on the correct distance. If fromChanges is set,
+		// record whether the tree path of each vertex contains edges that became more expensive or
+		// cheaper, and count the edges these changes require checking.
+		std::fill(distance.begin(), distance.end(), use(INF));
+		distance[source] = 0;
+		pathChange[source] = 0;
+		computeTreeOrder(source);
+		int64_t numEdgesToCheck = fromChanges ? decreasedEdges.size() : graph.numEdges();
+		for (int i = 1; i < treeOrder.size(); ++i)
+		{
+			const int v = treeOrder[i];
+			const int e = parentEdge[v];
+			const int u = graph.tail(e);
+			distance[v] = distance[u] + weights[e];
+			if (fromChanges)
+			{
+				pathChange[v] = pathChange[u] | (weightChange[e] > 0 ? INCREASED : 0) | (weightChange[e] < 0 ? DECREASED : 0);
+				if (pathChange[v] & INCREASED)
+					numEdgesToCheck += graph.incomingEdges(v).size();
+				if (pathChange[v] & DECREASED)
+					numEdgesToCheck += graph.outgoingEdges(v).size();
+			}
+		}
+
+		// Seed the search with the heads of all edges violating the triangle inequality. Checking the
+		// edges of scattered vertices is slower than a sequential pass over all edges, so the latter
+		// is used unless the changes require checking few edges.
+		queue.clear();
+		if (numEdgesToCheck < graph.numEdges() / 2)
+		{
+			for (int i = 1; i < treeOrder.size(); ++i)
+			{
+				const int v = treeOrder[i];
+				if (pathChange[v] & INCREASED)
+					FORALL_INCOMING_EDGES(graph, v, e)
+						relax(e);
+				if (pathChange[v] & DECREASED)
+					FORALL_OUTGOING_EDGES(graph, v, e)
+						relax(e);
+			}
+			for (const int e : decreasedEdges)
+				relax(e);
+		}
+		else
+		{
+			FORALL_EDGES(graph, e)
+				relax(e);
+		}
+		settleQueue();
+	}
+
+	// Improves the label of the head of e via e, if possible.
+	void relax(const int e) {
+		const int v = graph.head(e);
+		const double distToV = distance[graph.tail(e)] + weights[e];
+		if (distToV < distance[v])
+		{
+			distance[v] = distToV;
+			parentEdge[v] = e;
+			if (queue.contains(v))
+				queue.decreaseKey(v, distToV);
+			else
+				queue.insert(v, distToV);
+		}
+	}
+
+	// Runs a Dijkstra search from the vertices in the queue, improving the current labels.
+	void settleQueue() {
+		while (!queue.empty())
+		{
+			int u;
+			double distToU;
+			queue.deleteMin(u, distToU);
+			FORALL_OUTGOING_EDGES(graph, u, e)
+				relax(e);
+		}
+	}
+
+	// Orders the vertices in the tree given by parentEdge such that parents precede their children.
+	void computeTreeOrder(const int source) {
+		firstChild.assign(graph.numVertices() + 1, 0);
+		FORALL_VERTICES(graph, v)
+			if (parentEdge[v] != INVALID_EDGE)
+				++firstChild[graph.tail(parentEdge[v]) + 1];
+		for (int u = 0; u < graph.numVertices(); ++u)
+			firstChild[u + 1] += firstChild[u];
+
+		children.resize(firstChild.back());
+		std::vector<int> next(firstChild.begin(), firstChild.end() - 1);
+		FORALL_VERTICES(graph, v)
+			if (parentEdge[v] != INVALID_EDGE)
+				children[next[graph.tail(parentEdge[v])]++] = v;
+
+		treeOrder.clear();
+		treeOrder.push_back(source);
+		for (int i = 0; i < treeOrder.size(); ++i)
+		{
+			const int u = treeOrder[i];
+			for (int j = firstChild[u]; j < firstChild[u + 1]; ++j)
+				treeOrder.push_back(children[j]);
+		}
+	}
+
+	static constexpr double INF = std::numeric_limits<double>::infinity();
+
+	static constexpr int SAMPLE_INTERVAL = 64;   // Every this many repairable trees, both options are timed.
+	static constexpr int MIN_UNCHANGED_RATIO = 8; // Changes are tracked if at most 1/this of the weights change.
+
+	// The flags recording the changes on the tree path of a vertex.
+	static constexpr uint8_t INCREASED = 1; // An edge on the tree path became more expensive.
+	static constexpr uint8_t DECREASED = 2; // An edge on the tree path became cheaper.
+
+	const Graph& graph;                          // The input graph.
+	const std::vector<EdgeValue>& weights;       // The current edge weights.
+	AddressableKHeap<4, double> queue;           // The priority queue.
+	std::vector<double> distance;                // The distance of each vertex from the current source.
+	std::vector<int32_t> parentEdge;             // The parent edge of each vertex in the current tree.
+	std::vector<std::vector<int32_t>> storedTrees; // The stored tree of each origin (possibly empty).
+	const int64_t maxStoredTrees;                // The max number of trees that fit into the memory cap.
+	int64_t numStoredTrees;                      // The number of trees stored so far.
+	std::vector<int> treeIteration;              // The iteration in which each stored tree was computed.
+	int currentSource;                           // The source of the current tree.
+	int currentIteration;                        // The number of customizations so far.
+
+	std::vector<EdgeValue> previousWeights;      // The edge weights at the last customization.
+	std::vector<int8_t> weightChange;            // The sign of each edge's last weight change.
+	std::vector<int> decreasedEdges;             // The edges that became cheaper at the last customization.
+	bool trackChanges = false;                   // Are the changes on tree paths tracked in this iteration?
+	std::vector<uint8_t> pathChange;             // The changes on each vertex's path in the tree being repaired.
+
+	bool repairTrees;                            // Are the trees repaired in the current iteration?
+	int numTreesSinceSample = SAMPLE_INTERVAL - 1; // The repairable trees computed since the last sample.
+	int64_t sampleTime[2] = {0, 0};              // The time (in ns) of rebuilding/repairing the sampled trees.
+
+	std::vector<int> firstChild;                 // The index of each vertex's first child in children.
+	std::vector<int> children;                   // The children in the current tree, grouped by parent.
+	std::vector<int> treeOrder;                  // The vertices in the current tree, parents first.
+};
@@ -4,15 +4,24 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <ostream>
+#include <type_traits>
 #include <vector>
 
+#include <omp.h>
+
+#include "Algorithms/ALT/Landmarks.h"
+#include "Algorithms/TrafficAssignment/BatchedOneToManySearch.h"
+#include "Algorithms/TrafficAssignment/DeltaSteppingSearch.h"
 #include "DataStructures/Graph/Graph.h"
-#include "DataStructures/Utilities/OriginDestination.h"
+#include "DataStructures/Utilities/OriginDestinationPairs.h"
 #include "Stats/TrafficAssignment/AllOrNothingAssignmentStats.h"
+#include "Tools/Constants.h"
 #include "Tools/Simd/AlignedVector.h"
 #include "Tools/Timer.h"
 
@@ -20,22 +29,99 @@
 // turn and the corresponding OD-flow (in our case always a single flow unit) is assigned to each
 // edge on the shortest path between O and D. Other O-D paths are not assigned any flow. The
 // procedure can be used with different shortest-path algorithms.
+//
+// In lazy mode (classic assignment only), an OD-pair keeps its previous path without a search if
+// the cost of that path under the new weights is provably within a relative tolerance of the
+// shortest-path distance. The lower bound on the distance is the larger of the previous lower bound
+// and the landmark bound, each scaled by the smallest ratio between the new edge weights and the
+// weights it was computed for. Refreshing the landmark distances for the new weights takes two full
+// searches per landmark, so it is done only while the queries it saves are expected to take longer.
+//
+// If the OD-pairs have fewer distinct origins than there are threads available to the assignment
+// (classic assignment with plain Dijkstra only), the shortest paths are computed by a parallel
+// delta-stepping search from each origin instead. Other algorithms (e.g., constrained searches)
+// compute different paths and are never replaced.
+class DijkstraAdapter; // The plain Dijkstra search, the only one delta-stepping may replace.
+
 template <typename ShortestPathAlgoT>
 class AllOrNothingAssignment {
 public:
-	// Constructs an all-or-nothing assignment instance.
-	AllOrNothingAssignment(Graph& graph,
-						   const std::vector<ClusteredOriginDestination>& odPairs,
-						   const bool verbose = true, const bool elasticRebalance = false)
+	// The data that does not depend on the edge weights, computed once per input graph and shared by
+	// all assignments on it (e.g., by the user classes or by the periods of a multi-period run).
+	class Preprocessing {
+	public:
+		// Preprocesses the specified graph for the shortest-path algo, and in lazy mode computes the
+		// landmarks on the free-flow travel times.
+		Preprocessing(const Graph& graph, const bool elasticRebalance = false, const double lazyTolerance = -1)
+			: shortestPathAlgo(graph) {
+			if (lazyTolerance >= 0 && !elasticRebalance)
+			{
+				landmarkWeights = Landmarks::freeFlowLowerBounds(graph);
+				landmarks.preprocess(graph, landmarkWeights, graph.numLandmarks());
+			}
+		}
+
+		typename ShortestPathAlgoT::Preprocessing shortestPathAlgo; // The shortest-path algo's data.
+		std::vector<EdgeValue> landmarkWeights; // The edge weights the landmark distances refer to.
+		Landmarks landmarks;                    // The landmarks bounding the OD-distances in lazy mode.
+	};
+
+	// Constructs an all-or-nothing assignment instance routing on the specified weights. The
+	// preprocessing must have been done with the same elasticRebalance and lazyTolerance. The
+	// assignment may use up to numThreads threads (a single one if it is constructed inside a
+	// parallel region).
+	AllOrNothingAssignment(const Graph& graph, const std::vector<EdgeValue>& weights,
+						   const Preprocessing& preprocessing,
+						   const OriginDestinationPairs& odPairs,
+						   const bool verbose = true, const bool elasticRebalance = false,
+						   const bool batchedQueries = false, const double lazyTolerance = -1,
+						   const int numThreads = omp_get_max_threads())
 		: stats(odPairs.size()),
-		  shortestPathAlgo(graph),
+		  shortestPathAlgo(graph, weights, preprocessing.shortestPathAlgo),
+		  batchedSearch(graph, weights),
+		  deltaSteppingSearch(graph, weights),
 		  inputGraph(graph),
+		  weights(weights),
 		  odPairs(odPairs),
 		  verbose(verbose),
-		  elasticRebalance(elasticRebalance)
+		  elasticRebalance(elasticRebalance),
+		  batchedQueries(batchedQueries),
+		  lazyTolerance(lazyTolerance),
+		  useDeltaStepping(false),
+		  currentOrigin(INVALID_VERTEX)
 		{
 			Timer timer;
-			shortestPathAlgo.preprocess();
+			if (isLazy())
+			{
+				// The landmark distances are refreshed for the weights of this assignment.
+				landmarks = preprocessing.landmarks;
+				landmarkWeights = preprocessing.landmarkWeights;
+				distanceLowerBounds.assign(odPairs.size(), -1);
+			}
+			if (elasticRebalance && batchedQueries)
+			{
+				// The (2i)-th query is the passenger path of the i-th OD-pair and the (2i+1)-th query
+				// is the path of the corresponding rebalancing vehicle.
+				std::vector<int> sources, targets;
+				for (int i = 0; i < odPairs.size(); i++)
+				{
+					sources.push_back(odPairs.origin(i));
+					targets.push_back(odPairs.destination(i));
+					sources.push_back(odPairs.destination(i));
+					targets.push_back(odPairs.rebalancer(i));
+				}
+				batchedSearch.setQueries(sources, targets);
+			}
+			const int availableThreads = omp_in_parallel() ? 1 : numThreads;
+			if (std::is_same<ShortestPathAlgoT, DijkstraAdapter>::value && !elasticRebalance && availableThreads > 1)
+			{
+				std::vector<int> origins;
+				for (int i = 0; i < odPairs.size(); i++)
+					origins.push_back(odPairs.origin(i));
+				std::sort(origins.begin(), origins.end());
+				const int numOrigins = std::unique(origins.begin(), origins.end()) - origins.begin();
+				useDeltaStepping = numOrigins < availableThreads;
+			}
 			stats.totalPreprocessingTime = timer.elapsed();
 			stats.lastRoutingTime = stats.totalPreprocessingTime;
 			stats.totalRoutingTime = stats.totalPreprocessingTime;
@@ -51,6 +137,7 @@ public:
 		if (verbose) std::cout << "Iteration " << stats.numIterations << ": " << std::flush;
 
 		shortestPathAlgo.customize();
+		currentOrigin = INVALID_VERTEX;
 		stats.lastCustomizationTime = timer.elapsed();
 
 		timer.restart();
@@ -60,27 +147,46 @@ public:
 		stats.startIteration();
 
 		// find shortest path between each OD pair and collect flows
-		if (elasticRebalance) // comptue for elastic AMoD
+		if (elasticRebalance && batchedQueries) // compute for elastic AMoD, all queries in one pass
 		{
-			/*
-				TODO:
-				The current subroutine doesn't aggregate shortest path queries according to origin vertex, which may lead to large computation times.
+			batchedSearch.run(queryDistances, queryPaths);
 
-				A better solution would be to have four different shortest path queries to each origin-destination pair. That is, the OD-pair file would specify for each (virtual) origin-destination the id of the real od-pair, and a number in {0,..,3} specifying the type of query it represents. 
-			 */
+			for (int i = 0; i < odPairs.size(); i++)
+			{
+				const double cost_or = weights[odPairs.edge1(i)] + weights[odPairs.edge2(i)];
+				paths[i].clear();
+				if (queryDistances[2 * i] + queryDistances[2 * i + 1] < cost_or)
+				{ // real path used
+					paths[i].splice(paths[i].end(), queryPaths[2 * i]);
+					paths[i].splice(paths[i].end(), queryPaths[2 * i + 1]);
+				} else
+				{ // virtual path used
+					paths[i].push_back(odPairs.edge1(i));
+					paths[i].push_back(odPairs.edge2(i));
+				}
+			}
+
+			for (int i = 0; i < odPairs.size(); i++)
+				for(const auto& e : paths[i])
+					trafficFlows[e] += odPairs.volume(i);
+		}
+		else if (elasticRebalance) // comptue for elastic AMoD
+		{
+			// Each OD-pair issues two separate point-to-point queries here. Set batchedQueries to
+			// answer all of them with one one-to-many search per distinct source instead.
 			
 			for (int i = 0; i < odPairs.size(); i++)
 			{
 				std::list<int> path_od, path_dr, path_or;
 				double cost_od, cost_dr, cost_or = 0;
 				
-				cost_od = shortestPathAlgo.run(odPairs[i].origin, odPairs[i].destination, path_od); // passenger path from new origin to real destination
-				cost_dr = shortestPathAlgo.run(odPairs[i].destination, odPairs[i].rebalancer, path_dr); // path for rebalancer
+				cost_od = shortestPathAlgo.run(odPairs.origin(i), odPairs.destination(i), path_od); // passenger path from new origin to real destination
+				cost_dr = shortestPathAlgo.run(odPairs.destination(i), odPairs.rebalancer(i), path_dr); // path for rebalancer
 
-				path_or.push_back(odPairs[i].edge1);
-				path_or.push_back(odPairs[i].edge2);
+				path_or.push_back(odPairs.edge1(i));
+				path_or.push_back(odPairs.edge2(i));
 
-				cost_or = inputGraph.weight(odPairs[i].edge1) + inputGraph.weight(odPairs[i].edge2);
+				cost_or = weights[odPairs.edge1(i)] + weights[odPairs.edge2(i)];
 				
 				if (cost_od + cost_dr < cost_or) 
 				{ // real path used
@@ -92,19 +198,28 @@ public:
 				}
 				
 				for(const auto& e : paths[i])
-					trafficFlows[e] += odPairs[i].volume;
+					trafficFlows[e] += odPairs.volume(i);
 			}
 		}
+		else if (isLazy()) // compute for classic traffic assignment, skipping near-optimal paths
+		{
+			runLazily();
+		}
 		else // compute for classic traffic assignment
 		{
 			for (int i = 0; i < odPairs.size(); i++)
 			{
-				shortestPathAlgo.run(odPairs[i].origin, odPairs[i].destination, paths[i]);
+				findShortestPath(i);
 				for(const auto& e : paths[i])
-					trafficFlows[e] += odPairs[i].volume;
+					trafficFlows[e] += odPairs.volume(i);
 			}
 		}
-		
+
+		// The slack of the skipped OD-pairs is subtracted from the cost of the assigned flow.
+		stats.lastAssignedCost = 0;
+		FORALL_EDGES(inputGraph, e)
+			stats.lastAssignedCost += trafficFlows[e] * weights[e];
+		stats.lastCostLowerBound = stats.lastAssignedCost - lastSkippedSlack;
 		
 		stats.lastQueryTime = timer.elapsed();
 		stats.finishIteration();
@@ -115,6 +230,11 @@ public:
 			std::cout << "  Custom: " << stats.lastCustomizationTime << "ms";
 			std::cout << "  Queries: " << stats.lastQueryTime << "ms";
 			std::cout << "  Routing: " << stats.lastRoutingTime << "ms\n";
+			if (isLazy())
+			{
+				std::cout << "  Skipped queries: " << 100.0 * stats.lastNumSkippedQueries / std::max<int>(odPairs.size(), 1) << "%";
+				std::cout << "  Landmarks: " << stats.lastLandmarkTime << "ms\n";
+			}
 			std::cout << std::flush;
 		}
 	}
@@ -122,7 +242,7 @@ public:
 	// Returns the traffic flow on edge e.
 	double trafficFlowOn(const int e) const {
 		assert(e >= 0); assert(e < inputGraph.numEdges());
-		return (double)trafficFlows[e];
+		return trafficFlows[e];
 	}
 
 	std::vector<std::list<int>>& getPaths()
@@ -133,14 +253,146 @@ public:
 	AllOrNothingAssignmentStats stats; // Statistics about the execution.
 
 private:
-	using ODPairs = std::vector<ClusteredOriginDestination>;
+	using ODPairs = OriginDestinationPairs;
+
+	// Returns true if OD-pairs may keep their previous paths without a search.
+	bool isLazy() const {
+		return lazyTolerance >= 0 && !elasticRebalance;
+	}
+
+	// Assigns each OD-pair to its previous path if that path is provably near-optimal, and to a
+	// shortest path otherwise.
+	void runLazily() {
+		const bool refresh = shouldRefreshLandmarks();
+		if (refresh)
+		{
+			Timer timer;
+			landmarks.updateDistances(inputGraph, weights);
+			landmarkWeights.assign(weights.begin(), weights.end());
+			landmarkRefreshTime = timer.elapsed<std::chrono::microseconds>();
+			stats.lastLandmarkTime = landmarkRefreshTime / 1000;
+		}
+		const double landmarkWeightRatio = minWeightRatio(landmarkWeights);
+		const double previousWeightRatio = previousWeights.empty() ? 0 : minWeightRatio(previousWeights);
+
+		Timer timer;
+		lastSkippedSlack = 0;
+		for (int i = 0; i < odPairs.size(); i++)
+		{
+			const int origin = odPairs.origin(i);
+			const int destination = odPairs.destination(i);
+			if (distanceLowerBounds[i] >= 0)
+			{
+				const double landmarkBound = landmarkWeightRatio > 0 ? landmarkWeightRatio * landmarks.lowerBound(origin, destination) : 0;
+				const double lowerBound = std::max(previousWeightRatio * distanceLowerBounds[i], landmarkBound);
+				const double pathCost = costOf(paths[i]);
+				if (pathCost <= (1 + lazyTolerance) * lowerBound)
+				{
+					distanceLowerBounds[i] = lowerBound;
+					lastSkippedSlack += odPairs.volume(i) * (pathCost - lowerBound);
+					++stats.lastNumSkippedQueries;
+					for(const auto& e : paths[i])
+						trafficFlows[e] += odPairs.volume(i);
+					continue;
+				}
+			}
+
+			findShortestPath(i);
+			distanceLowerBounds[i] = costOf(paths[i]);
+			for(const auto& e : paths[i])
+				trafficFlows[e] += odPairs.volume(i);
+		}
+		const int numSearches = odPairs.size() - stats.lastNumSkippedQueries;
+		if (numSearches > 0)
+			searchTime = static_cast<double>(timer.elapsed<std::chrono::microseconds>()) / numSearches;
+		if (!previousWeights.empty())
+			(refresh ? numSkippedWithRefresh : numSkippedWithoutRefresh) = stats.lastNumSkippedQueries;
+		landmarksRefreshed = refresh;
+		previousWeights = weights;
+	}
+
+	// Returns true if the landmark distances should be refreshed in this iteration, i.e., if the
+	// searches saved by a refresh (as observed in the last iterations with and without a refresh)
+	// are expected to take longer than the refresh itself. Both options are measured once at the
+	// start and the one not chosen is retried periodically, so that the estimates stay current.
+	bool shouldRefreshLandmarks() {
+		if (previousWeights.empty())
+			return false; // there are no paths to keep yet
+		if (numSkippedWithRefresh < 0)
+			return true;
+		if (numSkippedWithoutRefresh < 0)
+			return false;
+		if (++numIterationsSinceRetry == LANDMARK_RETRY_INTERVAL)
+		{
+			numIterationsSinceRetry = 0;
+			return !landmarksRefreshed;
+		}
+		return landmarkRefreshTime < (numSkippedWithRefresh - numSkippedWithoutRefresh) * searchTime;
+	}
+
+	// Returns the smallest ratio between the current and the specified old weight of an edge, taken
+	// over the edges with positive old weight (0 if there is no such edge or a weight is negative).
+	template <typename WeightT>
+	double minWeightRatio(const std::vector<WeightT>& oldWeights) const {
+		double ratio = std::numeric_limits<double>::infinity();
+		FORALL_EDGES(inputGraph, e)
+			if (oldWeights[e] > 0)
+				ratio = std::min<double>(ratio, weights[e] / oldWeights[e]);
+		return ratio >= 0 && ratio < std::numeric_limits<double>::infinity() ? ratio : 0;
+	}
+
+	// Computes a shortest path for the i-th OD-pair in classic assignment.
+	void findShortestPath(const int i) {
+		if (!useDeltaStepping)
+		{
+			shortestPathAlgo.run(odPairs.origin(i), odPairs.destination(i), paths[i]);
+			return;
+		}
+		if (odPairs.origin(i) != currentOrigin)
+		{
+			currentOrigin = odPairs.origin(i);
+			deltaSteppingSearch.run(currentOrigin);
+		}
+		deltaSteppingSearch.getPath(odPairs.destination(i), paths[i]);
+	}
+
+	// Returns the cost of the specified path under the current weights.
+	double costOf(const std::list<int>& path) const {
+		double cost = 0;
+		for (const auto& e : path)
+			cost += weights[e];
+		return cost;
+	}
 
 	ShortestPathAlgoT shortestPathAlgo; // Algo computing shortest paths between OD-pairs.
-	Graph& inputGraph;					// The input graph.
+	BatchedOneToManySearch batchedSearch; // Computes the paths for all elastic queries in one pass.
+	DeltaSteppingSearch deltaSteppingSearch; // Computes the paths from few origins in parallel.
+	const Graph& inputGraph;			// The input graph.
+	const std::vector<EdgeValue>& weights; // The current edge weights.
 	const ODPairs& odPairs;             // The OD-pairs to be assigned onto the graph.
-	std::vector<int> trafficFlows;			// The traffic flows on the edges.
+	std::vector<double> trafficFlows;		// The traffic flows on the edges.
 	std::vector<std::list<int>> paths;	// paths of the individual od pairs
+	std::vector<double> queryDistances;	// distances of the batched elastic queries
+	std::vector<std::list<int>> queryPaths;	// paths of the batched elastic queries
 	const bool verbose;                 // Should informative messages be displayed?
 	const bool elasticRebalance;		// if true, compute compute AMoD with elastic demand
+	const bool batchedQueries;			// if true, route the elastic queries in one batch
+	const double lazyTolerance;			// relative tolerance for keeping paths (negative if not lazy)
+
+	static constexpr int LANDMARK_RETRY_INTERVAL = 10; // Iterations after which the other refresh option is retried.
+
+	Landmarks landmarks;                // The landmarks bounding the OD-distances in lazy mode.
+	std::vector<EdgeValue> landmarkWeights; // The edge weights the landmark distances refer to.
+	bool landmarksRefreshed = false;    // Were the landmark distances refreshed in the last iteration?
+	int landmarkRefreshTime = 0;        // The time (in microseconds) of the last refresh.
+	double searchTime = 0;              // The average time (in microseconds) of a search in the last iteration.
+	int numSkippedWithRefresh = -1;     // The queries skipped in the last iteration with a refresh.
+	int numSkippedWithoutRefresh = -1;  // The queries skipped in the last iteration without a refresh.
+	int numIterationsSinceRetry = 0;    // The iterations since the other refresh option was last retried.
+	std::vector<EdgeValue> previousWeights; // The edge weights in the previous iteration.
+	std::vector<double> distanceLowerBounds; // A lower bound on each OD-distance (-1 if unknown).
+	double lastSkippedSlack = 0;        // The total excess cost of the skipped OD-pairs.
+	bool useDeltaStepping;              // Are there too few origins to keep all threads busy?
+	int currentOrigin;                  // The origin of the last delta-stepping search.
 	
 };
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <list>
+#include <vector>
+
+#include <omp.h>
+
+#include "DataStructures/Graph/Graph.h"
+#include "DataStructures/Queues/AddressableKHeap.h"
+#include "Tools/Constants.h"
+
+// A many-to-many shortest-path engine that answers a fixed batch of point-to-point queries in one
+// pass. The queries are grouped by source, and for each distinct source a single Dijkstra search
+// is run until all targets of that source are settled. The searches for different sources run in
+// parallel, each thread using its own search space.
+class BatchedOneToManySearch {
+public:
+	// Constructs a batched search on the specified graph and edge weights.
+	BatchedOneToManySearch(const Graph& graph, const std::vector<EdgeValue>& weights)
+		: graph(graph), weights(weights) { }
+
+	// Sets the queries answered by each subsequent call to run. The i-th query asks for a shortest
+	// path from sources[i] to targets[i].
+	void setQueries(const std::vector<int>& sources, const std::vector<int>& targets) {
+		assert(sources.size() == targets.size());
+		querySource = sources;
+		queryTarget = targets;
+
+		// Group the queries by source, using a counting sort.
+		std::vector<int> firstQueryOfVertex(graph.numVertices() + 1, 0);
+		for (const int s : sources)
+			++firstQueryOfVertex[s + 1];
+		for (int v = 0; v < graph.numVertices(); ++v)
+			firstQueryOfVertex[v + 1] += firstQueryOfVertex[v];
+
+		queriesBySource.resize(sources.size());
+		std::vector<int> next(firstQueryOfVertex.begin(), firstQueryOfVertex.end() - 1);
+		for (int i = 0; i < sources.size(); ++i)
+			queriesBySource[next[sources[i]]++] = i;
+
+		distinctSources.clear();
+		firstQuery.clear();
+		for (int v = 0; v < graph.numVertices(); ++v)
+			if (firstQueryOfVertex[v] != firstQueryOfVertex[v + 1])
+			{
+				distinctSources.push_back(v);
+				firstQuery.push_back(firstQueryOfVertex[v]);
+			}
+		firstQuery.push_back(sources.size());
+	}
+
+	// Returns the number of distinct sources among the queries.
+	int numSources() const {
+		return distinctSources.size();
+	}
+
+	// Computes the distance and a shortest path for each query w.r.t. the current edge weights.
+	// Unreachable targets obtain an infinite distance and an empty path.
+	void run(std::vector<double>& distances, std::vector<std::list<int>>& paths) {
+		distances.resize(querySource.size());
+		paths.resize(querySource.size());
+		searchSpaces.resize(omp_get_max_threads());
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < distinctSources.size(); ++i)
+		{
+			SearchSpace& space = searchSpaces[omp_get_thread_num()];
+			space.init(graph.numVertices());
+			runSearch(space, i);
+
+			for (int j = firstQuery[i]; j < firstQuery[i + 1]; ++j)
+			{
+				const int q = queriesBySource[j];
+				const int t = queryTarget[q];
+				std::list<int>& path = paths[q];
+				path.clear();
+				if (space.round[t] != space.currentRound)
+				{
+					distances[q] = std::numeric_limits<double>::infinity();
+					continue;
+				}
+				distances[q] = space.distance[t];
+				for (int v = t; space.parentEdge[v] != INVALID_EDGE; v = graph.tail(space.parentEdge[v]))
+					path.push_front(space.parentEdge[v]);
+			}
+		}
+	}
+
+private:
+	// The labels and priority queue of a single Dijkstra search, reused over many searches.
+	struct SearchSpace {
+		// Makes sure that the search space can hold labels for n vertices, and starts a new round.
+		void init(const int n) {
+			if (distance.size() != n)
+			{
+				queue.resize(n);
+				distance.assign(n, 0);
+				parentEdge.assign(n, INVALID_EDGE);
+				round.assign(n, 0);
+				isTarget.assign(n, 0);
+				currentRound = 0;
+			}
+			++currentRound;
+			queue.clear();
+		}
+
+		AddressableKHeap<4, double> queue{0}; // The priority queue.
+		std::vector<double> distance;          // The tentative distance of each vertex.
+		std::vector<int> parentEdge;           // The edge on which each vertex was reached.
+		std::vector<int> round;                // The round in which each vertex was reached last.
+		std::vector<int> isTarget;             // The round in which each vertex was a target last.
+		int currentRound = 0;                  // The current round.
+	};
+
+	// Runs a Dijkstra search from the i-th distinct source until all of its targets are settled.
+	void runSearch(SearchSpace& space, const int i) const {
+		const int source = distinctSources[i];
+		int numTargetsLeft = 0;
+		for (int j = firstQuery[i]; j < firstQuery[i + 1]; ++j)
+		{
+			const int t = queryTarget[queriesBySource[j]];
+			if (space.isTarget[t] != space.currentRound)
+			{
+				space.isTarget[t] = space.currentRound;
+				++numTargetsLeft;
+			}
+		}
+
+		space.round[source] = space.currentRound;
+		space.distance[source] = 0;
+		space.parentEdge[source] = INVALID_EDGE;
+		space.queue.insert(source, 0);
+		while (!space.queue.empty() && numTargetsLeft > 0)
+		{
+			int u;
+			double distToU;
+			space.queue.deleteMin(u, distToU);
+			if (space.isTarget[u] == space.currentRound)
+				--numTargetsLeft;
+
+			FORALL_OUTGOING_EDGES(graph, u, e)
+			{
+				const int v = graph.head(e);
+				const double distToV = distToU + weights[e];
+				if (space.round[v] != space.currentRound)
+				{
+					space.round[v] = space.currentRound;
+					space.distance[v] = distToV;
+					space.parentEdge[v] = e;
+					space.queue.insert(v, distToV);
+				}
+				else if (distToV < space.distance[v])
+				{
+					space.distance[v] = distToV;
+					space.parentEdge[v] = e;
+					space.queue.decreaseKey(v, distToV);
+				}
+			}
+		}
+	}
+
+	const Graph& graph;                  // The input graph.
+	const std::vector<EdgeValue>& weights; // The current edge weights.
+
+	std::vector<int> querySource;        // The source of each query.
+	std::vector<int> queryTarget;        // The target of each query.
+	std::vector<int> queriesBySource;    // The IDs of the queries, grouped by source.
+	std::vector<int> distinctSources;    // The distinct sources, in increasing order.
+	std::vector<int> firstQuery;         // The index in queriesBySource of each source's first query.
+	std::vector<SearchSpace> searchSpaces; // One search space for each thread.
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <vector>
+
+#include <omp.h>
+
+#include "DataStructures/Graph/Graph.h"
+#include "Tools/ConcurrentHelpers.h"
+#include "Tools/Constants.h"
+#include "Tools/Workarounds.h"
+
+// A parallel single-source shortest-path search (delta-stepping), intended for the case where a
+// few origins carry most of the demand and per-origin parallelism leaves threads idle. Vertices are
+// kept in buckets of width delta. The vertices in the current bucket are scanned in parallel, where
+// light edges (weight at most delta) are relaxed repeatedly until the bucket stays empty, and heavy
+// edges are relaxed once afterwards. Distances are improved with atomic updates. The parent edges
+// are recovered in a final traversal from the source along the edges on which the distances are
+// attained, which yields a tree even if there are cycles of zero weight.
+class DeltaSteppingSearch {
+public:
+	// Constructs a delta-stepping search on the specified graph and edge weights.
+	DeltaSteppingSearch(const Graph& graph, const std::vector<EdgeValue>& weights)
+		: graph(graph),
+		  weights(weights),
+		  distance(graph.numVertices()),
+		  parentEdge(graph.numVertices()),
+		  lastScan(graph.numVertices()),
+		  delta(0) { }
+
+	// Computes the distances from the specified source to all vertices w.r.t. the current weights.
+	void run(const int source) {
+		assert(source >= 0); assert(source < graph.numVertices());
+		chooseDelta();
+		std::fill(distance.begin(), distance.end(), use(INF));
+		std::fill(lastScan.begin(), lastScan.end(), -1);
+		for (auto& bucket : buckets)
+			bucket.clear();
+		distance[source] = 0;
+		insert(source);
+
+		std::vector<std::vector<int>> newVertices(omp_get_max_threads());
+		std::vector<int> frontier;
+		std::vector<int> settled;
+		for (int i = 0; i < buckets.size(); ++i)
+		{
+			settled.clear();
+			while (!buckets[i].empty())
+			{
+				// Stale entries (whose distances have decreased into earlier buckets) are skipped.
+				frontier.clear();
+				for (const int v : buckets[i])
+					if (bucketOf(distance[v]) == i)
+					{
+						frontier.push_back(v);
+						if (lastScan[v] != i)
+						{
+							lastScan[v] = i;
+							settled.push_back(v);
+						}
+					}
+				buckets[i].clear();
+				relaxEdges(frontier, true, newVertices);
+				collect(newVertices);
+			}
+			relaxEdges(settled, false, newVertices);
+			collect(newVertices);
+		}
+
+		computeParentEdges(source, newVertices);
+	}
+
+	// Returns the distance to v from the source of the last search.
+	double distanceTo(const int v) const {
+		assert(v >= 0); assert(v < graph.numVertices());
+		return distance[v];
+	}
+
+	// Returns a shortest path to t from the source of the last search (empty if t is unreachable).
+	void getPath(const int t, std::list<int>& path) const {
+		path.clear();
+		if (distance[t] == INF)
+			return;
+		for (int v = t; parentEdge[v] != INVALID_EDGE; v = graph.tail(parentEdge[v]))
+			path.push_front(parentEdge[v]);
+	}
+
+private:
+	// Sets the bucket width to the average edge weight.
+	void chooseDelta() {
+		double sum = 0;
+		FORALL_EDGES(graph, e)
+			sum += weights[e];
+		delta = graph.numEdges() > 0 ? sum / graph.numEdges() : 1;
+		if (!(delta > 0))
+			delta = 1;
+	}
+
+	// Returns the index of the bucket containing vertices at the specified distance.
+	int64_t bucketOf(const double dist) const {
+		return static_cast<int64_t>(dist / delta);
+	}
+
+	// Inserts v into the bucket corresponding to its current distance.
+	void insert(const int v) {
+		const int64_t i = bucketOf(distance[v]);
+		if (i >= buckets.size())
+			buckets.resize(i + 1);
+		buckets[i].push_back(v);
+	}
+
+	// Relaxes the light (or heavy) edges out of the specified vertices in parallel. Each thread
+	// records the heads whose distances it improved.
+	void relaxEdges(const std::vector<int>& vertices, const bool light,
+					std::vector<std::vector<int>>& newVertices) {
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int j = 0; j < vertices.size(); ++j)
+		{
+			std::vector<int>& improved = newVertices[omp_get_thread_num()];
+			const int u = vertices[j];
+			double distToU;
+			__atomic_load(&distance[u], &distToU, __ATOMIC_RELAXED);
+			FORALL_OUTGOING_EDGES(graph, u, e)
+			{
+				if ((weights[e] <= delta) != light)
+					continue;
+				const int v = graph.head(e);
+				const double distToV = distToU + weights[e];
+				double current;
+				__atomic_load(&distance[v], &current, __ATOMIC_RELAXED);
+				if (distToV < current)
+				{
+					atomicFetchMin(distance[v], distToV);
+					improved.push_back(v);
+				}
+			}
+		}
+	}
+
+	// Moves the vertices improved by the threads into their buckets.
+	void collect(std::vector<std::vector<int>>& newVertices) {
+		for (auto& improved : newVertices)
+		{
+			for (const int v : improved)
+				insert(v);
+			improved.clear();
+		}
+	}
+
+	// Picks for each reached vertex an incoming edge on which its distance is attained. The vertices
+	// are visited level by level from the source, and each vertex is claimed (atomically) by the
+	// first such edge whose tail has already been visited, so no vertex can become its own ancestor.
+	void computeParentEdges(const int source, std::vector<std::vector<int>>& newVertices) {
+		std::fill(parentEdge.begin(), parentEdge.end(), use(UNVISITED));
+		parentEdge[source] = INVALID_EDGE;
+		std::vector<int> frontier = {source};
+		while (!frontier.empty())
+		{
+			#pragma omp parallel for schedule(dynamic, 64)
+			for (int j = 0; j < frontier.size(); ++j)
+			{
+				std::vector<int>& visited = newVertices[omp_get_thread_num()];
+				const int u = frontier[j];
+				FORALL_OUTGOING_EDGES(graph, u, e)
+				{
+					const int v = graph.head(e);
+					int expected = UNVISITED;
+					if (distance[u] + weights[e] == distance[v] &&
+						__atomic_compare_exchange_n(&parentEdge[v], &expected, e, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+						visited.push_back(v);
+				}
+			}
+			frontier.clear();
+			for (auto& visited : newVertices)
+			{
+				frontier.insert(frontier.end(), visited.begin(), visited.end());
+				visited.clear();
+			}
+		}
+	}
+
+	static constexpr double INF = std::numeric_limits<double>::infinity();
+	static constexpr int UNVISITED = -2; // The parent edge of vertices not (yet) visited from the source.
+
+	const Graph& graph;                     // The input graph.
+	const std::vector<EdgeValue>& weights;  // The current edge weights.
+	std::vector<double> distance;           // The distance of each vertex from the source.
+	std::vector<int> parentEdge;            // The edge on which each vertex is reached.
+	std::vector<int64_t> lastScan;          // The last bucket in which each vertex was scanned.
+	std::vector<std::vector<int>> buckets;  // The buckets of vertices with similar distances.
+	double delta;                           // The width of each bucket.
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cmath>
+
+#include <vectorclass/vectorclass.h>
+#include <vectorclass/vectormath_exp.h>
+
+// #define TA_NO_SIMD_COSTS
+
+// Helpers for evaluating travel cost and objective functions over a range of edges. A function f
+// provides a scalar overload f(e, x), which evaluates edge e at flow x, and a Vec4d overload
+// f(e, x), which evaluates the edges e, ..., e + 3 at the flows x[0], ..., x[3]. Blocks of four
+// edges are evaluated with the Vec4d overload and the remaining edges with the scalar one. Defining
+// TA_NO_SIMD_COSTS falls back to the scalar overload everywhere.
+
+// Returns the value of edge e (or the values of edges e, ..., e + 3) in the specified row.
+template <typename ValueT>
+inline ValueT loadEdgeValues(const double* row, const int e);
+
+template <>
+inline double loadEdgeValues<double>(const double* row, const int e) {
+	return row[e];
+}
+
+template <>
+inline Vec4d loadEdgeValues<Vec4d>(const double* row, const int e) {
+	return Vec4d().load(row + e);
+}
+
+// Returns the value of edge e (or the values of edges e, ..., e + 3) in the specified row of
+// single-precision values, converted to double precision.
+template <typename ValueT>
+inline ValueT loadEdgeValues(const float* row, const int e);
+
+template <>
+inline double loadEdgeValues<double>(const float* row, const int e) {
+	return row[e];
+}
+
+template <>
+inline Vec4d loadEdgeValues<Vec4d>(const float* row, const int e) {
+	const Vec4f values = Vec4f().load(row + e);
+	return Vec4d(extend_low(values), extend_high(values));
+}
+
+// Returns the values in the specified row of the edges that x refers to, i.e., of edge e if x is a
+// double and of edges e, ..., e + 3 if x is a Vec4d.
+template <typename ValueT, typename RowValueT>
+inline ValueT loadEdgeValuesLike(const ValueT& /*x*/, const RowValueT* row, const int e) {
+	return loadEdgeValues<ValueT>(row, e);
+}
+
+// Stores the value of edge e (or the values of edges e, ..., e + 3) in the specified row.
+inline void storeEdgeValues(double* row, const int e, const double value) {
+	row[e] = value;
+}
+
+inline void storeEdgeValues(double* row, const int e, const Vec4d& value) {
+	value.store(row + e);
+}
+
+inline void storeEdgeValues(float* row, const int e, const double value) {
+	row[e] = value;
+}
+
+inline void storeEdgeValues(float* row, const int e, const Vec4d& value) {
+	compress(value.get_low(), value.get_high()).store(row + e);
+}
+
+// Adds the value of a single edge or the values of a block of edges to the partial sums.
+inline void addTo(Vec4d& partialSums, const double value) {
+	partialSums += Vec4d(value, 0, 0, 0);
+}
+
+inline void addTo(Vec4d& partialSums, const Vec4d& values) {
+	partialSums += values;
+}
+
+// Returns a if the condition holds and b otherwise (elementwise for blocks of edges).
+inline double choose(const bool condition, const double a, const double b) {
+	return condition ? a : b;
+}
+
+inline Vec4d choose(const Vec4db& condition, const Vec4d& a, const Vec4d& b) {
+	return select(condition, a, b);
+}
+
+// Computes x^N for a nonnegative integer N known at compile time, by repeated squaring.
+template <int N>
+struct IntegerPower {
+	template <typename ValueT>
+	static ValueT of(const ValueT& x) {
+		const ValueT half = IntegerPower<N / 2>::of(x);
+		return N % 2 == 0 ? half * half : half * half * x;
+	}
+};
+
+template <>
+struct IntegerPower<1> {
+	template <typename ValueT>
+	static ValueT of(const ValueT& x) {
+		return x;
+	}
+};
+
+template <>
+struct IntegerPower<0> {
+	template <typename ValueT>
+	static ValueT of(const ValueT& /*x*/) {
+		return ValueT(1);
+	}
+};
+
+// Returns x^N.
+template <int N, typename ValueT>
+inline ValueT integerPower(const ValueT& x) {
+	return IntegerPower<N>::of(x);
+}
+
+// Returns x^y for nonnegative x.
+inline double power(const double x, const double y) {
+	return std::pow(x, y);
+}
+
+inline Vec4d power(const Vec4d& x, const Vec4d& y) {
+	return pow(x, y);
+}
+
+// Calls f(e, Vec4d()) for each block of four edges e, ..., e + 3 in [first, last) and f(e, 0.0) for
+// each remaining edge. The second argument only tells f the value type to work with.
+template <typename FunctionT>
+inline void forEachEdgeBlock(const int first, const int last, FunctionT f) {
+	int e = first;
+#ifndef TA_NO_SIMD_COSTS
+	for (; e + 4 <= last; e += 4)
+		f(e, Vec4d());
+#endif
+	for (; e < last; ++e)
+		f(e, 0.0);
+}
+
+// Writes f(e, x[e]) to out[e] for each edge e in [first, last). The rows x and out may hold single-
+// or double-precision values, and f always works in double precision.
+template <typename InT, typename OutT, typename FunctionT>
+inline void evaluateEdgeRange(const int first, const int last, const InT* x, OutT* out, FunctionT f) {
+	int e = first;
+#ifndef TA_NO_SIMD_COSTS
+	for (; e + 4 <= last; e += 4)
+		storeEdgeValues(out, e, f(e, loadEdgeValues<Vec4d>(x, e)));
+#endif
+	for (; e < last; ++e)
+		out[e] = f(e, loadEdgeValues<double>(x, e));
+}
+
+// Returns the sum of f(e, x[e]) over all edges e in [first, last). The sum is accumulated in double
+// precision, even if x holds single-precision values.
+template <typename InT, typename FunctionT>
+inline double sumOverEdgeRange(const int first, const int last, const InT* x, FunctionT f) {
+	double sum = 0;
+	int e = first;
+#ifndef TA_NO_SIMD_COSTS
+	Vec4d partialSums(0);
+	for (; e + 4 <= last; e += 4)
+		partialSums += f(e, loadEdgeValues<Vec4d>(x, e));
+	sum = horizontal_add(partialSums);
+#endif
+	for (; e < last; ++e)
+		sum += f(e, loadEdgeValues<double>(x, e));
+	return sum;
+}
+
+// Writes f(kernel, e, x[e]) to out[e] for each edge e in [first, last), where kernel is the
+// homogeneous travel cost function of e's class, as passed by costFunction.forEachEdgeClass.
+template <typename CostFunctionT, typename InT, typename OutT, typename FunctionT>
+inline void evaluateEdgeRangeByClass(
+	const CostFunctionT& costFunction, const int first, const int last, const InT* x, OutT* out, FunctionT f) {
+	costFunction.forEachEdgeClass(first, last, [&](const int begin, const int end, const auto& kernel) {
+		evaluateEdgeRange(begin, end, x, out, [&](const int e, const auto& y) { return f(kernel, e, y); });
+	});
+}
+
+// Returns the sum of f(kernel, e, x[e]) over all edges e in [first, last), where kernel is the
+// homogeneous travel cost function of e's class, as passed by costFunction.forEachEdgeClass.
+template <typename CostFunctionT, typename InT, typename FunctionT>
+inline double sumOverEdgeRangeByClass(
+	const CostFunctionT& costFunction, const int first, const int last, const InT* x, FunctionT f) {
+	double sum = 0;
+	costFunction.forEachEdgeClass(first, last, [&](const int begin, const int end, const auto& kernel) {
+		sum += sumOverEdgeRange(begin, end, x, [&](const int e, const auto& y) { return f(kernel, e, y); });
+	});
+	return sum;
+}
@@ -5,14 +5,24 @@
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include <vectorclass/vectorclass.h>
 
-#include "Algorithms/TrafficAssignment/AllOrNothingAssignment.h"
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
+#include "Algorithms/TrafficAssignment/MultiClassAllOrNothingAssignment.h"
+#include "Algorithms/TrafficAssignment/ObjectiveFunctions/ObjectiveKernel.h"
+#include "Algorithms/TrafficAssignment/PathFlowDecomposition.h"
 #include "Algorithms/TrafficAssignment/UnivariateMinimization.h"
 #include "DataStructures/Graph/Graph.h"
-#include "DataStructures/Utilities/OriginDestination.h"
+#include "DataStructures/Utilities/FlowStore.h"
+#include "DataStructures/Utilities/OriginDestinationPairs.h"
+#include "DataStructures/Utilities/PathSnapshot.h"
+#include "DataStructures/Utilities/PathStore.h"
+#include "Tools/BackgroundWriter.h"
 #include "Tools/Timer.h"
 #include "Stats/TrafficAssignment/FrankWolfeAssignmentStats.h"
 
@@ -21,25 +31,42 @@
 // A traffic assignment procedure based on the Frank-Wolfe method (also known as convex combinations
 // method). At its heart are iterative shortest-paths computations. The algo can be parameterized to
 // compute the user equilibrium or system optimum, and to use different travel cost functions and
-// shortest-path algorithms.
+// shortest-path algorithms. Several user classes, each with its own OD-pairs and passenger car
+// equivalent (PCE), can share the graph. Their all-or-nothing assignments run concurrently, and the
+// line search operates on the combined (PCE-weighted) flow.
 template <
     template <typename> class ObjFunctionT, typename TravelCostFunction,
     typename ShortestPathAlgoT>
 class FrankWolfeAssignment {
 public:
 
-	// Constructs an assignment procedure based on the Frank-Wolfe method.
-	FrankWolfeAssignment(Graph& graph, const std::vector<ClusteredOriginDestination>& odPairs, std::ofstream& csv, std::ofstream& patternFile, std::ofstream& pathFile, std::ofstream& weightFile, const bool verbose = true, const bool elasticRebalance = false)
-		: allOrNothingAssignment(graph, odPairs, verbose, elasticRebalance),
-		  graph(graph),	
+	// The preprocessing data of the shortest-path algo, which can be shared by several assignments
+	// on the same graph.
+	using ShortestPathPreprocessing = typename MultiClassAllOrNothingAssignment<ShortestPathAlgoT>::Preprocessing;
+
+	// Constructs an assignment procedure based on the Frank-Wolfe method. The edge weights are kept
+	// in the specified vector, so that several assignments can run on the same graph. The OD-pairs
+	// of all user classes, concatenated class after class, are passed as odPairs.
+	FrankWolfeAssignment(const Graph& graph, std::vector<EdgeValue>& weights, const ShortestPathPreprocessing& preprocessing, const OriginDestinationPairs& odPairs, const std::vector<OriginDestinationPairs>& odPairsOfClass, const std::vector<double>& pceOfClass, std::ofstream& csv, std::ofstream& patternFile, std::ofstream& pathFile, PathStoreWriter& pathStore, FlowStoreWriter& flowStore, std::ofstream& weightFile, std::ofstream& pathFlowFile, const bool verbose = true, const bool elasticRebalance = false, const bool batchedQueries = false, const double lazyTolerance = -1)
+		: allOrNothingAssignment(graph, weights, preprocessing, odPairsOfClass, pceOfClass, verbose, elasticRebalance, batchedQueries, lazyTolerance),
+		  graph(graph),
+		  edgeWeights(weights),
+		  odPairs(odPairs),
 		  trafficFlows(graph.numEdges()),
 		  pointOfSight(graph.numEdges()),
+		  secondDerivatives(graph.numEdges()),
+		  flowsOfClass(numClasses() > 1 ? numClasses() : 0, std::vector<EdgeValue>(graph.numEdges())),
+		  pointOfSightOfClass(flowsOfClass.size(), std::vector<EdgeValue>(graph.numEdges())),
 		  travelCostFunction(graph),
 		  objFunction(travelCostFunction, graph),
 		  csv(csv),
 		  patternFile(patternFile),
 		  pathFile(pathFile),
+		  pathStore(pathStore),
+		  flowStore(flowStore),
 		  weightFile(weightFile),
+		  pathFlowFile(pathFlowFile),
+		  pathFlows(pathFlowFile.is_open() ? odPairs.size() : 0),
 		  verbose(verbose) {
 		stats.totalRunningTime = allOrNothingAssignment.stats.totalRoutingTime;
 	}
@@ -58,26 +85,19 @@ public:
 
 		stats.lastRunningTime = timer.elapsed();
 		stats.lastLineSearchTime = stats.lastRunningTime - substats.lastRoutingTime;
-		stats.objFunctionValue = objFunction(trafficFlows);
 		stats.finishIteration();
 
 		if (csv.is_open()) {
-			csv << substats.numIterations << "," << substats.lastCustomizationTime << "," << substats.lastQueryTime << ",";
-			csv << stats.lastLineSearchTime << "," << stats.lastRunningTime << ",";
-			csv << stats.objFunctionValue << "," << stats.totalTravelCost << "," << std::endl;
+			std::ostringstream line;
+			line << substats.numIterations << "," << substats.lastCustomizationTime << "," << substats.lastQueryTime << ",";
+			line << stats.lastLineSearchTime << "," << stats.lastRunningTime << ",";
+			line << stats.objFunctionValue << "," << stats.totalTravelCost << ",,";
+			line << substats.lastNumSkippedQueries << "," << substats.lastLandmarkTime << ",";
+			writeStatsLine(line.str());
 		}
 		
-		if (pathFile.is_open())
-			{
-				for (auto i = 0; i < paths.size(); i++)
-				{
-					pathFile << substats.numIterations << ',' << i;
-					for(const auto& e : paths[i])
-						pathFile << "," << e;
-
-					pathFile << '\n';
-				}
-			}
+		writePaths();
+		writeFlowSnapshot();
 		
 
 		if (verbose) {
@@ -93,12 +113,12 @@ public:
 			Timer timer;
 			stats.startIteration();
 
-			// Update travel costs
-			updateTravelCosts();
-
-			// Direction finding.
+			// Direction finding. The edge weights were already updated by the last move.
 			findDescentDirection();
 			paths = allOrNothingAssignment.getPaths();
+
+			// The lower bound reported by the all-or-nothing assignment accounts for skipped queries.
+			stats.relativeGap = (currentCost - substats.lastCostLowerBound) / currentCost;
 			
 			const auto tau = findMoveSize();
 			moveAlongDescentDirection(tau);
@@ -111,26 +131,19 @@ public:
 									
 			stats.lastRunningTime = timer.elapsed();
 			stats.lastLineSearchTime = stats.lastRunningTime - substats.lastRoutingTime;
-			stats.objFunctionValue = objFunction(trafficFlows);
 			stats.finishIteration();
 
 			if (csv.is_open()) {
-				csv << substats.numIterations << "," << substats.lastCustomizationTime << "," << substats.lastQueryTime << ",";
-				csv << stats.lastLineSearchTime << "," << stats.lastRunningTime << ",";
-				csv << stats.objFunctionValue << "," << stats.totalTravelCost << "," << std::endl;
+				std::ostringstream line;
+				line << substats.numIterations << "," << substats.lastCustomizationTime << "," << substats.lastQueryTime << ",";
+				line << stats.lastLineSearchTime << "," << stats.lastRunningTime << ",";
+				line << stats.objFunctionValue << "," << stats.totalTravelCost << ",";
+				line << stats.relativeGap << "," << substats.lastNumSkippedQueries << "," << substats.lastLandmarkTime << ",";
+				writeStatsLine(line.str());
 			}	
 			
-			if (pathFile.is_open())
-			{
-				for (auto i = 0; i < paths.size(); i++)
-				{
-					pathFile << substats.numIterations << ',' << i;
-					for(const auto& e : paths[i])
-						pathFile << "," << e;
-
-					pathFile << '\n';
-				}
-			}
+			writePaths();
+			writeFlowSnapshot();
 			
 
 			if (verbose) {
@@ -140,6 +153,7 @@ public:
 				std::cout << "  Avg change in OD-distances: " << substats.avgChangeInDistances << "\n";
 				std::cout << "  Objective function value: " << stats.objFunctionValue << "\n";
 				std::cout << "  Total travel cost: " << stats.totalTravelCost << "\n";
+				std::cout << "  Relative gap: " << stats.relativeGap << "\n";
 				std::cout << std::flush;
 			}
 		} while ((numIterations > 0 || substats.avgChangeInDistances > 1e-2) &&
@@ -157,43 +171,54 @@ public:
 			std::cout << std::flush;
 		}
 
-		if (patternFile.is_open()) 
-			FORALL_EDGES(graph, e)
-			{			
-				const int tail = graph.tail(e);
-				const int head = graph.head(e);
-				const auto flow = trafficFlows[e];
-			
-				patternFile << substats.numIterations << ',' << tail << ',' << head << ',' << graph.freeTravelTime(e) << ',' << travelCostFunction(e, flow) << ',' << graph.capacity(e) << ',' << flow << '\n';
-			}
+		// The flows of the final iteration are always kept.
+		if (!flowStore.isDue(substats.numIterations))
+			writeFlowSnapshot(true);
+
+		// The final outputs refer to the solver's state (and to weights), which no longer changes.
+		// The writer is drained before returning.
+		writer.post([this, &weights, numIterations] {
+			// The flow pattern is written in the order and with the IDs of the input file.
+			if (patternFile.is_open()) 
+				FORALL_EDGES(graph, i)
+				{			
+					const int e = graph.edgeId(i);
+					const int tail = graph.originalVertexId(graph.tail(e));
+					const int head = graph.originalVertexId(graph.head(e));
+					const auto flow = trafficFlows[e];
+				
+					patternFile << allOrNothingAssignment.stats.numIterations << ',' << tail << ',' << head << ',' << graph.freeTravelTime(e) << ',' << travelCostFunction(e, flow) << ',' << graph.capacity(e) << ',' << flow;
+					for (const auto& flows : flowsOfClass)
+						patternFile << ',' << flows[e];
+					patternFile << '\n';
+				}
 
-		if (weightFile.is_open())
-			for (int i=0; i < numIterations; i++)
-				weightFile << i+1 << "," << weights[i] << std::endl;
-		
+			if (weightFile.is_open())
+				for (int i=0; i < numIterations; i++)
+					weightFile << i+1 << "," << weights[i] << std::endl;
+
+			writePathFlows();
+		});
+		writer.wait();
 	}
 
 	void determineInitialSolution() {
 		FORALL_EDGES(graph, e)
-			graph.setWeight(e, objFunction.derivative(e, 0));
+			edgeWeights[e] = objFunction.derivative(e, 0);
 
 		allOrNothingAssignment.run();
-		
+		if (pathFlowFile.is_open())
+			pathFlows.updateDirection(allOrNothingAssignment.getPaths(), 0);
+
+		// Move from the zero flows all the way to the all-or-nothing assignment.
 		FORALL_EDGES(graph, e)
-		{
-			trafficFlows[e] = allOrNothingAssignment.trafficFlowOn(e);
-			stats.totalTravelCost += trafficFlows[e] * travelCostFunction(e, trafficFlows[e]);
-		}
+			pointOfSight[e] = allOrNothingAssignment.trafficFlowOn(e);
+		updatePointOfSightOfClasses(0);
+		moveAlongDescentDirection(1);
 
 		// allOrNothingAssignment.stats.numIterations = 1;
 	}
 
-	// Updates traversal costs.
-	void updateTravelCosts() {
-		FORALL_EDGES(graph, e)
-			graph.setWeight(e, objFunction.derivative(e, trafficFlows[e]));
-	}
-
 	// Finds the descent direction.
 	void findDescentDirection() {
 		allOrNothingAssignment.run();
@@ -201,14 +226,18 @@ public:
 		if (allOrNothingAssignment.stats.numIterations == 2) {
 			FORALL_EDGES(graph, e)
 				pointOfSight[e] = allOrNothingAssignment.trafficFlowOn(e);
+			updatePointOfSightOfClasses(0);
+			if (pathFlowFile.is_open())
+				pathFlows.updateDirection(allOrNothingAssignment.getPaths(), 0);
 			return;
 		}
 
+		objFunction.secondDerivatives(0, graph.numEdges(), trafficFlows.data(), secondDerivatives.data());
 		auto num = 0.0, den = 0.0;
 		FORALL_EDGES(graph, e) {
-			const auto residualDirection = pointOfSight[e] - trafficFlows[e];
-			const auto secondDerivative = objFunction.secondDerivative(e, trafficFlows[e]);
-			const auto fwDirection = allOrNothingAssignment.trafficFlowOn(e) - trafficFlows[e];
+			const double residualDirection = pointOfSight[e] - trafficFlows[e];
+			const double secondDerivative = secondDerivatives[e];
+			const double fwDirection = allOrNothingAssignment.trafficFlowOn(e) - trafficFlows[e];
 			num += residualDirection * secondDerivative * fwDirection;
 			den += residualDirection * secondDerivative * (fwDirection - residualDirection);
 		}
@@ -217,40 +246,140 @@ public:
     
 		FORALL_EDGES(graph, e)
 			pointOfSight[e] = alpha * pointOfSight[e] + (1 - alpha) * allOrNothingAssignment.trafficFlowOn(e);
+		updatePointOfSightOfClasses(alpha);
+		if (pathFlowFile.is_open())
+			pathFlows.updateDirection(allOrNothingAssignment.getPaths(), alpha);
+#else
+		FORALL_EDGES(graph, e)
+			pointOfSight[e] = allOrNothingAssignment.trafficFlowOn(e);
+		updatePointOfSightOfClasses(0);
+		if (pathFlowFile.is_open())
+			pathFlows.updateDirection(allOrNothingAssignment.getPaths(), 0);
 #endif
 	}
 
 	// Find the optimal move size.
 	double findMoveSize() const {
 		return bisectionMethod([this](const double tau) {
-								   double sum = 0.0;
-								   FORALL_EDGES(graph, e) {
-#ifndef TA_NO_CFW
-									   const auto direction = pointOfSight[e] - trafficFlows[e];
-#else
-									   const auto direction = allOrNothingAssignment.trafficFlowOn(e) - trafficFlows[e];
-#endif
-									   sum += direction * objFunction.derivative(e, trafficFlows[e] + tau * direction);
-								   }
-								   return sum;
-							   }, 0, 1);
+			return sumOverEdgeRangeByClass(travelCostFunction, 0, graph.numEdges(), trafficFlows.data(),
+				[this, tau](const auto& cost, const int e, const auto& x) {
+					const auto direction = loadEdgeValuesLike(x, pointOfSight.data(), e) - x;
+					return direction * objectiveKernel(objFunction, cost).derivative(e, x + tau * direction);
+				});
+		}, 0, 1);
 	}
 
-	// Moves along the descent direction.
+	// Moves along the descent direction. The same pass over the edges evaluates the new flows: it
+	// computes the objective function value and the total travel cost, sets the edge weights for the
+	// next direction finding, and computes the cost of the new flows under these weights (from which
+	// the next relative gap is derived).
 	void moveAlongDescentDirection(const double tau) {
-		FORALL_EDGES(graph, e)
-		{
-#ifndef TA_NO_CFW			
-			trafficFlows[e] += tau * (pointOfSight[e] - trafficFlows[e]);
-#else
-			trafficFlows[e] += tau * (allOrNothingAssignment.trafficFlowOn(e) - trafficFlows[e]);
-#endif			
-			stats.totalTravelCost += trafficFlows[e] * travelCostFunction(e, trafficFlows[e]);
-		}  
+		EdgeValue* const flows = trafficFlows.data();
+		EdgeValue* const weights = edgeWeights.data();
+		Vec4d objFunctionValue(0), totalTravelCost(0), costUnderWeights(0);
+		travelCostFunction.forEachEdgeClass(0, graph.numEdges(), [&](const int first, const int last, const auto& cost) {
+			const auto objective = objectiveKernel(objFunction, cost);
+			forEachEdgeBlock(first, last, [&](const int e, auto x) {
+				x = loadEdgeValuesLike(x, flows, e);
+				x += tau * (loadEdgeValuesLike(x, pointOfSight.data(), e) - x);
+				const auto weight = objective.derivative(e, x);
+				storeEdgeValues(flows, e, x);
+				storeEdgeValues(weights, e, weight);
+				addTo(objFunctionValue, objective.value(e, x));
+				addTo(totalTravelCost, x * cost(e, x));
+				addTo(costUnderWeights, x * weight);
+			});
+		});
+		stats.objFunctionValue = horizontal_add(objFunctionValue);
+		stats.totalTravelCost = horizontal_add(totalTravelCost);
+		currentCost = horizontal_add(costUnderWeights);
+		for (int c = 0; c < flowsOfClass.size(); ++c)
+			FORALL_EDGES(graph, e)
+				flowsOfClass[c][e] += tau * (pointOfSightOfClass[c][e] - flowsOfClass[c][e]);
+		if (pathFlowFile.is_open())
+			pathFlows.moveAlongDirection(tau);
+	}
+
+	// Combines the point of sight of each class with its all-or-nothing flow, with weight alpha on
+	// the former, in the same way as the combined point of sight (if there are several classes).
+	void updatePointOfSightOfClasses(const double alpha) {
+		for (int c = 0; c < pointOfSightOfClass.size(); ++c)
+			FORALL_EDGES(graph, e)
+				pointOfSightOfClass[c][e] = alpha * pointOfSightOfClass[c][e] + (1 - alpha) * allOrNothingAssignment.trafficFlowOn(c, e);
+	}
+
+	// Returns the number of user classes.
+	int numClasses() const {
+		return allOrNothingAssignment.numClasses();
 	}
 	
+	// Hands a line of the statistics CSV file to the background writer.
+	void writeStatsLine(std::string line) {
+		writer.post([this, line] { csv << line << std::endl; });
+	}
+
+	// Writes the current path of each input row of OD-pairs, using the edge IDs of the input file.
+	// The paths are copied into a snapshot, which is written in the background.
+	void writePaths() {
+		if (!pathStore.isOpen() && !pathFile.is_open())
+			return;
+		const int iteration = allOrNothingAssignment.stats.numIterations;
+		const auto snapshot = std::make_shared<const PathSnapshot>(paths);
+		writer.post([this, iteration, snapshot] {
+			if (pathStore.isOpen())
+				pathStore.writeIteration(iteration, *snapshot, [this](const int e) { return graph.originalEdgeId(e); });
+			if (!pathFile.is_open())
+				return;
+			for (int row = 0; row < odPairs.numRows(); row++)
+			{
+				pathFile << iteration << ',' << row;
+				for(const auto& e : (*snapshot)[odPairs.pairOfRow(row)])
+					pathFile << "," << graph.originalEdgeId(e);
+				pathFile << '\n';
+			}
+		});
+	}
+
+	// Writes a snapshot of the edge flows and costs (in input edge order), if one is due or forced.
+	void writeFlowSnapshot(const bool force = false) {
+		const int iteration = allOrNothingAssignment.stats.numIterations;
+		if (!flowStore.isOpen() || !(force || flowStore.isDue(iteration)))
+			return;
+		auto flows = std::make_shared<std::vector<double>>(graph.numEdges());
+		auto costs = std::make_shared<std::vector<double>>(graph.numEdges());
+		FORALL_EDGES(graph, i)
+		{
+			const int e = graph.edgeId(i);
+			(*flows)[i] = trafficFlows[e];
+			(*costs)[i] = travelCostFunction(e, trafficFlows[e]);
+		}
+		writer.post([this, iteration, flows, costs] { flowStore.write(iteration, *flows, *costs); });
+	}
+
+	// Writes the path-flow decomposition of the final solution, one line per OD-pair and distinct
+	// path with positive flow, using the vertex and edge IDs of the input file.
+	void writePathFlows() {
+		if (!pathFlowFile.is_open())
+			return;
+		for (int i = 0; i < odPairs.size(); i++)
+		{
+			const int origin = graph.originalVertexId(odPairs.origin(i));
+			const int destination = graph.originalVertexId(odPairs.destination(i));
+			pathFlows.forEachPath(i, [&](const int32_t* first, const int32_t* last, const double share) {
+				if (share <= 0)
+					return;
+				pathFlowFile << origin << ',' << destination << ',' << share << ',' << share * odPairs.volume(i);
+				for (const int32_t* e = first; e != last; ++e)
+					pathFlowFile << ',' << graph.originalEdgeId(*e);
+				pathFlowFile << '\n';
+			});
+		}
+		if (verbose)
+			std::cout << "Path flows: " << pathFlows.numPaths() << " distinct paths with " << pathFlows.numPathEdges() << " edges\n" << std::flush;
+	}
+
 	// Returns the traffic flow on edge e.
-	const double& trafficFlowOn(const int e) const {
+	double trafficFlowOn(const int e) const {
 		assert(e >= 0); assert(e < graph.numEdges());
 		return trafficFlows[e];
 	}
@@ -258,21 +387,32 @@ public:
 	FrankWolfeAssignmentStats stats; // Statistics about the execution.
 
 private:
-	using AllOrNothing = AllOrNothingAssignment<ShortestPathAlgoT>;
+	using AllOrNothing = MultiClassAllOrNothingAssignment<ShortestPathAlgoT>;
 	using ObjFunction = ObjFunctionT<TravelCostFunction>;
 
 	AllOrNothing allOrNothingAssignment;   // The all-or-nothing assignment algo used as a subroutine.
-	Graph& graph;               // The input graph.
-	std::vector<double> trafficFlows;    // The traffic flows on the edges.
-	std::vector<double> pointOfSight;            // The point defining the descent direction d = s - x
+	const Graph& graph;         // The input graph.
+	std::vector<EdgeValue>& edgeWeights; // The current edge weights.
+	const OriginDestinationPairs& odPairs; // The OD-pairs to be assigned onto the graph.
+	std::vector<EdgeValue> trafficFlows;    // The traffic flows on the edges.
+	std::vector<EdgeValue> pointOfSight;            // The point defining the descent direction d = s - x
+	std::vector<double> secondDerivatives;       // The second derivatives of the objective at x
+	std::vector<std::vector<EdgeValue>> flowsOfClass;        // The flows of each class (if several)
+	std::vector<std::vector<EdgeValue>> pointOfSightOfClass; // The point of sight of each class (if several)
+	double currentCost = 0;                      // The cost of x under the current edge weights
 	TravelCostFunction travelCostFunction; // A functor returning the travel cost on an edge.
 	ObjFunction objFunction;               // The objective function to be minimized (UE or SO).
 	std::ofstream& csv;                    // The output CSV file containing statistics.
 	std::ofstream& patternFile;            // The output file containing the flow patterns.
 	std::ofstream& pathFile;				// Output file for individual paths
+	PathStoreWriter& pathStore;            // Binary output store for individual paths
+	FlowStoreWriter& flowStore;            // Binary output store for per-iteration edge flows
 	std::ofstream& weightFile;				// Output file for path weights
+	std::ofstream& pathFlowFile;           // Output file for the path-flow decomposition
+	PathFlowDecomposition pathFlows;       // The distinct paths of each OD-pair and their flows
 	const bool verbose;                    // Should informative messages be displayed?
 	std::vector<std::list<int>> paths;	// paths of the individual od pairs
+	BackgroundWriter writer;               // Writes the output files while the solver continues.
 };
 
 // An alias template for a user-equilibrium (UE) traffic assignment.
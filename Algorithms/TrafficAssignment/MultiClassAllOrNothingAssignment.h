@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <omp.h>
+
+#include "Algorithms/TrafficAssignment/AllOrNothingAssignment.h"
+#include "DataStructures/Graph/Graph.h"
+#include "DataStructures/Utilities/OriginDestinationPairs.h"
+#include "Stats/TrafficAssignment/AllOrNothingAssignmentStats.h"
+#include "Tools/Timer.h"
+
+// An all-or-nothing assignment for several user classes (e.g., cars and trucks) sharing one graph.
+// Each class has its own OD-pairs and a passenger car equivalent (PCE), the factor by which a unit
+// of its flow counts towards the combined flow. All classes are routed on the same edge weights,
+// so a class-specific multiplier on the travel cost would not change any path; the PCE is what
+// distinguishes the classes. Each class has its own all-or-nothing assignment, and the classes are
+// routed concurrently if there are several. The combined flow on an edge is the PCE-weighted sum
+// of the class flows. The paths are reported class after class.
+template <typename ShortestPathAlgoT>
+class MultiClassAllOrNothingAssignment {
+public:
+	// The classes share the preprocessing data of the graph.
+	using Preprocessing = typename AllOrNothingAssignment<ShortestPathAlgoT>::Preprocessing;
+
+	// Constructs an all-or-nothing assignment for the user classes with the specified OD-pairs and
+	// PCEs, routing on the specified weights. The OD-pairs must outlive this object.
+	MultiClassAllOrNothingAssignment(const Graph& graph, const std::vector<EdgeValue>& weights,
+									 const Preprocessing& preprocessing,
+									 const std::vector<OriginDestinationPairs>& odPairsOfClass,
+									 const std::vector<double>& pceOfClass,
+									 const bool verbose = true, const bool elasticRebalance = false,
+									 const bool batchedQueries = false, const double lazyTolerance = -1)
+		: stats(numPairsIn(odPairsOfClass)),
+		  inputGraph(graph),
+		  pceOfClass(pceOfClass),
+		  trafficFlows(graph.numEdges()),
+		  verbose(verbose) {
+		assert(!odPairsOfClass.empty());
+		assert(odPairsOfClass.size() == pceOfClass.size());
+		// Several classes are routed concurrently, each on a single thread (nested regions are serialized).
+		const int threadsPerClass = odPairsOfClass.size() == 1 ? omp_get_max_threads() : 1;
+		for (int c = 0; c < odPairsOfClass.size(); ++c)
+		{
+			// The classes report on their own only if they are routed one at a time.
+			allOrNothingOfClass.emplace_back(new AllOrNothing(
+				graph, weights, preprocessing, odPairsOfClass[c], verbose && odPairsOfClass.size() == 1, elasticRebalance, batchedQueries, lazyTolerance,
+				threadsPerClass));
+			stats.totalPreprocessingTime += allOrNothingOfClass.back()->stats.totalPreprocessingTime;
+		}
+		stats.lastRoutingTime = stats.totalPreprocessingTime;
+		stats.totalRoutingTime = stats.totalPreprocessingTime;
+		if (numClasses() > 1)
+		{
+			paths.resize(stats.lastDistances.size());
+			if (verbose) std::cout << "  Prepro (" << numClasses() << " classes): " << stats.totalPreprocessingTime << "ms" << std::endl;
+		}
+	}
+
+	// Assigns the OD-flows of all classes to their currently shortest paths.
+	void run() {
+		Timer timer;
+		++stats.numIterations;
+		stats.startIteration();
+		if (verbose && numClasses() > 1) std::cout << "Iteration " << stats.numIterations << ": " << std::flush;
+
+		// Nested parallel regions inside the classes run on a single thread.
+		#pragma omp parallel for schedule(dynamic, 1) num_threads(std::min(numClasses(), omp_get_max_threads())) if (numClasses() > 1)
+		for (int c = 0; c < numClasses(); ++c)
+			allOrNothingOfClass[c]->run();
+		stats.lastRoutingTime = timer.elapsed();
+
+		stats.lastCustomizationTime = 0;
+		std::fill(trafficFlows.begin(), trafficFlows.end(), 0);
+		int firstPair = 0;
+		for (int c = 0; c < numClasses(); ++c)
+		{
+			const AllOrNothing& aon = *allOrNothingOfClass[c];
+			const AllOrNothingAssignmentStats& classStats = aon.stats;
+			stats.lastChecksum += classStats.lastChecksum;
+			stats.maxChangeInDistances = std::max(stats.maxChangeInDistances, classStats.maxChangeInDistances);
+			stats.avgChangeInDistances = std::max(stats.avgChangeInDistances, classStats.avgChangeInDistances);
+			stats.lastNumSkippedQueries += classStats.lastNumSkippedQueries;
+			stats.lastAssignedCost += pceOfClass[c] * classStats.lastAssignedCost;
+			stats.lastCostLowerBound += pceOfClass[c] * classStats.lastCostLowerBound;
+			stats.lastCustomizationTime = std::max(stats.lastCustomizationTime, classStats.lastCustomizationTime);
+			stats.lastLandmarkTime = std::max(stats.lastLandmarkTime, classStats.lastLandmarkTime);
+			FORALL_EDGES(inputGraph, e)
+				trafficFlows[e] += pceOfClass[c] * aon.trafficFlowOn(e);
+
+			if (numClasses() > 1)
+			{
+				const std::vector<std::list<int>>& classPaths = allOrNothingOfClass[c]->getPaths();
+				std::copy(classPaths.begin(), classPaths.end(), paths.begin() + firstPair);
+				firstPair += classPaths.size();
+			}
+		}
+		stats.lastQueryTime = stats.lastRoutingTime - stats.lastCustomizationTime;
+		stats.finishIteration();
+
+		if (verbose && numClasses() > 1) {
+			std::cout << " done.\n";
+			std::cout << "  Checksum: " << stats.lastChecksum;
+			std::cout << "  Custom: " << stats.lastCustomizationTime << "ms";
+			std::cout << "  Queries: " << stats.lastQueryTime << "ms";
+			std::cout << "  Routing: " << stats.lastRoutingTime << "ms\n";
+			std::cout << std::flush;
+		}
+	}
+
+	// Returns the number of user classes.
+	int numClasses() const {
+		return allOrNothingOfClass.size();
+	}
+
+	// Returns the combined (PCE-weighted) traffic flow on edge e.
+	double trafficFlowOn(const int e) const {
+		assert(e >= 0); assert(e < inputGraph.numEdges());
+		return trafficFlows[e];
+	}
+
+	// Returns the traffic flow of class c on edge e.
+	double trafficFlowOn(const int c, const int e) const {
+		assert(c >= 0); assert(c < numClasses());
+		return allOrNothingOfClass[c]->trafficFlowOn(e);
+	}
+
+	// Returns the path of each OD-pair, class after class.
+	std::vector<std::list<int>>& getPaths() {
+		return numClasses() == 1 ? allOrNothingOfClass[0]->getPaths() : paths;
+	}
+
+	AllOrNothingAssignmentStats stats; // Statistics about the execution, combined over all classes.
+
+private:
+	using AllOrNothing = AllOrNothingAssignment<ShortestPathAlgoT>;
+
+	// Returns the total number of OD-pairs in the specified classes.
+	static int numPairsIn(const std::vector<OriginDestinationPairs>& odPairsOfClass) {
+		int numPairs = 0;
+		for (const auto& odPairs : odPairsOfClass)
+			numPairs += odPairs.size();
+		return numPairs;
+	}
+
+	const Graph& inputGraph;                                    // The input graph.
+	const std::vector<double> pceOfClass;                       // The PCE of each class.
+	std::vector<std::unique_ptr<AllOrNothing>> allOrNothingOfClass; // The assignment of each class.
+	std::vector<double> trafficFlows;                           // The combined flow on each edge.
+	std::vector<std::list<int>> paths;                          // The paths of all classes (if several).
+	const bool verbose;                                         // Should informative messages be displayed?
+};
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
+#include "Algorithms/TrafficAssignment/ObjectiveFunctions/ObjectiveKernel.h"
 #include "DataStructures/Graph/Graph.h"
 #include "Algorithms/TrafficAssignment/ObjectiveFunctions/SystemOptimum.h"
 #include "Algorithms/TrafficAssignment/ObjectiveFunctions/UserEquilibrium.h"
@@ -10,35 +14,82 @@ template <typename TravelCostFunctionT>
 class CombinedEquilibrium {
 public:
 	// Constructs an UE objective function.
-CombinedEquilibrium(TravelCostFunctionT travelCostFunction, Graph& graph) : travelCostFunction(travelCostFunction), graph(graph), alpha(graph.combinedEquilibriumParameter()), systemOptimumObj(travelCostFunction, graph), userEquilibriumObj(travelCostFunction, graph) {
+CombinedEquilibrium(TravelCostFunctionT travelCostFunction, const Graph& graph) : travelCostFunction(travelCostFunction), graph(graph), alpha(graph.combinedEquilibriumParameter()) {
 	}
 
 	// Returns the value of the objective function for the specified edge flows.
-	double operator()(const std::vector<double>& flows) const {
-		return interpolate(systemOptimumObj(flows), userEquilibriumObj(flows));
+	double operator()(const std::vector<EdgeValue>& flows) const {
+		return sumOverEdgeRangeByClass(travelCostFunction, 0, flows.size(), flows.data(), [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).value(e, x);
+		});
 	}
 
 	// Returns the weight of edge e, given the flow x on e.
 	double derivative(const int e, const double x) const {
-		return interpolate(systemOptimumObj.derivative(e, x), userEquilibriumObj.derivative(e, x));
+		return travelCostFunction.withKernelOf(e, [this, e, x](const auto& cost) {
+			return objectiveKernel(*this, cost).derivative(e, x);
+		});
 	}
 
 	// Returns the weight of edge e, given the flow x on e.
 	double secondDerivative(const int e, const double x) const {
-		return interpolate(systemOptimumObj.secondDerivative(e, x), userEquilibriumObj.secondDerivative(e, x));
+		return travelCostFunction.withKernelOf(e, [this, e, x](const auto& cost) {
+			return objectiveKernel(*this, cost).secondDerivative(e, x);
+		});
+	}
+
+	// Writes the weight of edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(travelCostFunction, first, last, x, out, [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).derivative(e, x);
+		});
+	}
+
+	// Writes the second derivative at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(travelCostFunction, first, last, x, out, [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).secondDerivative(e, x);
+		});
+	}
+
+	// Returns the weight of the SO objective function in this objective function.
+	double systemOptimumWeight() const {
+		return alpha;
+	}
+
+	// Returns the contribution of edge e (or edges e, ..., e + 3) with the travel cost function cost
+	// to the objective function value at x.
+	template <typename CostT, typename ValueT>
+	ValueT value(const CostT& cost, const int e, const ValueT& x) const {
+		return interpolate(SystemOptimumT::value(cost, e, x), UserEquilibriumT::value(cost, e, x));
+	}
+
+	// Returns the weight of edge e (or edges e, ..., e + 3) with the travel cost function cost at x,
+	// i.e., the interpolation alpha * (c + x * c') + (1 - alpha) * c, which evaluates c and c' once.
+	template <typename CostT, typename ValueT>
+	ValueT derivative(const CostT& cost, const int e, const ValueT& x) const {
+		return cost(e, x) + alpha * x * cost.derivative(e, x);
+	}
+
+	// Returns the second derivative for edge e (or edges e, ..., e + 3) with the travel cost function cost at x,
+	// i.e., the interpolation alpha * (2 * c' + x * c'') + (1 - alpha) * c'.
+	template <typename CostT, typename ValueT>
+	ValueT secondDerivative(const CostT& cost, const int e, const ValueT& x) const {
+		return (1 + alpha) * cost.derivative(e, x) + alpha * x * cost.secondDerivative(e, x);
 	}
 
 private:
-	double interpolate(const double so_value, const double ue_value) const
+	template <typename ValueT>
+	ValueT interpolate(const ValueT& so_value, const ValueT& ue_value) const
 	{
 		return alpha * so_value + (1 - alpha) * ue_value;
 	}
 
 	TravelCostFunctionT travelCostFunction; // A functor returning the travel cost on an edge.
-	Graph& graph;
+	const Graph& graph;
 	
 	double alpha;
 
-	SystemOptimum<TravelCostFunctionT> systemOptimumObj;
-	UserEquilibrium<TravelCostFunctionT> userEquilibriumObj;
+	using SystemOptimumT = SystemOptimum<TravelCostFunctionT>;
+	using UserEquilibriumT = UserEquilibrium<TravelCostFunctionT>;
 };
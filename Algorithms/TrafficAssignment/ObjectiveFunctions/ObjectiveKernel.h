@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
+#include "Algorithms/TrafficAssignment/TravelCostFunctions/BprFunction.h"
+
+// The per-edge terms of an objective function (its value, derivative and second derivative) on the
+// edges of one class, whose travel cost function is given by a homogeneous kernel. The methods
+// evaluate edge e at a double x or edges e, ..., e + 3 at a Vec4d x.
+//
+// The primary template composes the objective's formulas with the kernel's methods. The
+// specializations below fuse both into a single expression for particular kernels. They exploit
+// that the terms of each objective are alpha times the SO terms plus (1 - alpha) times the UE terms,
+// where alpha is the objective's SO weight (1 for SO, 0 for UE, and the CE parameter for CE).
+template <typename ObjFunctionT, typename KernelT>
+class ObjectiveKernel {
+public:
+	// Constructs the terms of the specified objective function for the specified kernel.
+	ObjectiveKernel(const ObjFunctionT& objFunction, const KernelT& cost) : objFunction(objFunction), cost(cost) {}
+
+	// Returns the contribution of edge e to the objective function value at x.
+	template <typename ValueT>
+	ValueT value(const int e, const ValueT& x) const {
+		return objFunction.value(cost, e, x);
+	}
+
+	// Returns the weight of edge e at x.
+	template <typename ValueT>
+	ValueT derivative(const int e, const ValueT& x) const {
+		return objFunction.derivative(cost, e, x);
+	}
+
+	// Returns the second derivative for edge e at x.
+	template <typename ValueT>
+	ValueT secondDerivative(const int e, const ValueT& x) const {
+		return objFunction.secondDerivative(cost, e, x);
+	}
+
+private:
+	const ObjFunctionT& objFunction; // The objective function.
+	const KernelT& cost;             // The travel cost function of the edges.
+};
+
+// The terms for the BPR kernel t0 + c * x^BETA, which are
+//   value(x) = x * (t0 + (alpha + (1 - alpha) / (BETA + 1)) * c * x^BETA),
+//   derivative(x) = t0 + (1 + alpha * BETA) * c * x^BETA,
+//   secondDerivative(x) = (1 + alpha * BETA) * BETA * c * x^(BETA - 1).
+// The factors depend only on alpha and BETA and are computed once per kernel.
+template <typename ObjFunctionT, int BETA>
+class ObjectiveKernel<ObjFunctionT, BprFunction::RoadKernel<BETA>> {
+public:
+	// Constructs the terms of the specified objective function for the specified kernel.
+	ObjectiveKernel(const ObjFunctionT& objFunction, const BprFunction::RoadKernel<BETA>& cost)
+		: cost(cost),
+		  valueFactor(objFunction.systemOptimumWeight() + (1 - objFunction.systemOptimumWeight()) / (BETA + 1)),
+		  derivativeFactor(1 + objFunction.systemOptimumWeight() * BETA) {}
+
+	// Returns the contribution of edge e to the objective function value at x.
+	template <typename ValueT>
+	ValueT value(const int e, const ValueT& x) const {
+		return x * (cost.template freeFlowTimeOf<ValueT>(e) + valueFactor * cost.template slopeOf<ValueT>(e) * integerPower<BETA>(x));
+	}
+
+	// Returns the weight of edge e at x.
+	template <typename ValueT>
+	ValueT derivative(const int e, const ValueT& x) const {
+		return cost.template freeFlowTimeOf<ValueT>(e) + derivativeFactor * cost.template slopeOf<ValueT>(e) * integerPower<BETA>(x);
+	}
+
+	// Returns the second derivative for edge e at x.
+	template <typename ValueT>
+	ValueT secondDerivative(const int e, const ValueT& x) const {
+		return derivativeFactor * BETA * cost.template slopeOf<ValueT>(e) * integerPower<BETA - 1>(x);
+	}
+
+private:
+	const BprFunction::RoadKernel<BETA>& cost; // The travel cost function of the edges.
+	const double valueFactor;                  // The factor of c * x^(BETA + 1) in the value.
+	const double derivativeFactor;             // The factor of c * x^BETA in the derivative.
+};
+
+// The terms for the BPR kernel t0 + c * x^beta with a per-edge exponent beta, which are the same as
+// for a fixed exponent. The factors depend on beta and are computed on the fly.
+template <typename ObjFunctionT>
+class ObjectiveKernel<ObjFunctionT, BprFunction::GeneralRoadKernel> {
+public:
+	// Constructs the terms of the specified objective function for the specified kernel.
+	ObjectiveKernel(const ObjFunctionT& objFunction, const BprFunction::GeneralRoadKernel& cost)
+		: cost(cost), alpha(objFunction.systemOptimumWeight()) {}
+
+	// Returns the contribution of edge e to the objective function value at x.
+	template <typename ValueT>
+	ValueT value(const int e, const ValueT& x) const {
+		const ValueT beta = cost.template exponentOf<ValueT>(e);
+		const ValueT valueFactor = alpha + (1 - alpha) / (beta + 1);
+		return x * (cost.template freeFlowTimeOf<ValueT>(e) + valueFactor * cost.template slopeOf<ValueT>(e) * power(x, beta));
+	}
+
+	// Returns the weight of edge e at x.
+	template <typename ValueT>
+	ValueT derivative(const int e, const ValueT& x) const {
+		const ValueT beta = cost.template exponentOf<ValueT>(e);
+		return cost.template freeFlowTimeOf<ValueT>(e) + (1 + alpha * beta) * cost.template slopeOf<ValueT>(e) * power(x, beta);
+	}
+
+	// Returns the second derivative for edge e at x.
+	template <typename ValueT>
+	ValueT secondDerivative(const int e, const ValueT& x) const {
+		const ValueT beta = cost.template exponentOf<ValueT>(e);
+		return (1 + alpha * beta) * beta * cost.template slopeOf<ValueT>(e) * power(x, beta - 1);
+	}
+
+private:
+	const BprFunction::GeneralRoadKernel& cost; // The travel cost function of the edges.
+	const double alpha;                         // The SO weight of the objective function.
+};
+
+// The terms for the inverse demand function s * x + i, which are
+//   value(x) = x * (s * x + i),
+//   derivative(x) = (1 + alpha) * s * x + i,
+//   secondDerivative(x) = (1 + alpha) * s.
+template <typename ObjFunctionT>
+class ObjectiveKernel<ObjFunctionT, BprFunction::DemandKernel> {
+public:
+	// Constructs the terms of the specified objective function for the specified kernel.
+	ObjectiveKernel(const ObjFunctionT& objFunction, const BprFunction::DemandKernel& cost)
+		: cost(cost), slopeFactor(1 + objFunction.systemOptimumWeight()) {}
+
+	// Returns the contribution of edge e to the objective function value at x.
+	template <typename ValueT>
+	ValueT value(const int e, const ValueT& x) const {
+		return x * (cost.template slopeOf<ValueT>(e) * x + cost.template interceptOf<ValueT>(e));
+	}
+
+	// Returns the weight of edge e at x.
+	template <typename ValueT>
+	ValueT derivative(const int e, const ValueT& x) const {
+		return slopeFactor * cost.template slopeOf<ValueT>(e) * x + cost.template interceptOf<ValueT>(e);
+	}
+
+	// Returns the second derivative for edge e at x.
+	template <typename ValueT>
+	ValueT secondDerivative(const int e, const ValueT& /*x*/) const {
+		return slopeFactor * cost.template slopeOf<ValueT>(e);
+	}
+
+private:
+	const BprFunction::DemandKernel& cost; // The travel cost function of the edges.
+	const double slopeFactor;              // The factor of s * x in the derivative.
+};
+
+// Returns the terms of the specified objective function for the specified kernel.
+template <typename ObjFunctionT, typename KernelT>
+inline ObjectiveKernel<ObjFunctionT, KernelT> objectiveKernel(const ObjFunctionT& objFunction, const KernelT& cost) {
+	return ObjectiveKernel<ObjFunctionT, KernelT>(objFunction, cost);
+}
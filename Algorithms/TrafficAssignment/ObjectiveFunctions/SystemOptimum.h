@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
+#include "Algorithms/TrafficAssignment/ObjectiveFunctions/ObjectiveKernel.h"
 #include "DataStructures/Graph/Graph.h"
 
 // Represents the system-optimum (SO) objective function. The flow pattern that minimizes the SO
@@ -10,27 +14,68 @@ template <typename TravelCostFunctionT>
 class SystemOptimum {
 public:
 	// Constructs a SO objective function.
-	SystemOptimum(TravelCostFunctionT travelCostFunction, Graph& graph) : travelCostFunction(travelCostFunction), graph(graph) {}
+	SystemOptimum(TravelCostFunctionT travelCostFunction, const Graph& graph) : travelCostFunction(travelCostFunction), graph(graph) {}
 
 	// Returns the value of the objective function for the specified edge flows.
-	double operator()(const std::vector<double>& flows) const {
-		double sum = 0;
-		for (int e = 0; e < flows.size(); ++e)
-			sum += flows[e] * travelCostFunction(e, flows[e]);
-		return sum;
+	double operator()(const std::vector<EdgeValue>& flows) const {
+		return sumOverEdgeRangeByClass(travelCostFunction, 0, flows.size(), flows.data(), [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).value(e, x);
+		});
 	}
 
 	// Returns the weight of edge e, given the flow x on e. AKA derivative
 	double derivative(const int e, const double x) const {
-		return travelCostFunction(e, x) + x * travelCostFunction.derivative(e, x);
+		return travelCostFunction.withKernelOf(e, [this, e, x](const auto& cost) {
+			return objectiveKernel(*this, cost).derivative(e, x);
+		});
 	}
 	
 	// Returns the second order partial derivative with respect to the e-th variable x_e at x_e = x.
 	double secondDerivative(const int e, const double x) const {
-		return 2 * travelCostFunction.derivative(e, x) + x * travelCostFunction.secondDerivative(e, x);
+		return travelCostFunction.withKernelOf(e, [this, e, x](const auto& cost) {
+			return objectiveKernel(*this, cost).secondDerivative(e, x);
+		});
+	}
+
+	// Writes the weight of edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(travelCostFunction, first, last, x, out, [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).derivative(e, x);
+		});
+	}
+
+	// Writes the second derivative at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(travelCostFunction, first, last, x, out, [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).secondDerivative(e, x);
+		});
+	}
+
+	// Returns the weight of the SO objective function in this objective function.
+	static constexpr double systemOptimumWeight() {
+		return 1;
+	}
+
+	// Returns the contribution of edge e (or edges e, ..., e + 3) with the travel cost function cost
+	// to the objective function value at x.
+	template <typename CostT, typename ValueT>
+	static ValueT value(const CostT& cost, const int e, const ValueT& x) {
+		return x * cost(e, x);
+	}
+
+	// Returns the weight of edge e (or edges e, ..., e + 3) with the travel cost function cost at x.
+	template <typename CostT, typename ValueT>
+	static ValueT derivative(const CostT& cost, const int e, const ValueT& x) {
+		return cost(e, x) + x * cost.derivative(e, x);
+	}
+
+	// Returns the second derivative for edge e (or edges e, ..., e + 3) with the travel cost function cost at x.
+	template <typename CostT, typename ValueT>
+	static ValueT secondDerivative(const CostT& cost, const int e, const ValueT& x) {
+		return 2 * cost.derivative(e, x) + x * cost.secondDerivative(e, x);
 	}
 
 private:
 	TravelCostFunctionT travelCostFunction; // A functor returning the travel cost on an edge.
-	Graph& graph;
+	const Graph& graph;
 };
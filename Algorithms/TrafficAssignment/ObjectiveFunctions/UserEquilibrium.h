@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
+#include "Algorithms/TrafficAssignment/ObjectiveFunctions/ObjectiveKernel.h"
 #include "DataStructures/Graph/Graph.h"
 
 // Represents the user-equilibrium (UE) objective function. The flow pattern that minimizes the UE
@@ -10,30 +14,69 @@ template <typename TravelCostFunctionT>
 class UserEquilibrium {
 public:
 	// Constructs an UE objective function.
-	UserEquilibrium(TravelCostFunctionT travelCostFunction, Graph& graph) : travelCostFunction(travelCostFunction), graph(graph) { }	
+	UserEquilibrium(TravelCostFunctionT travelCostFunction, const Graph& graph) : travelCostFunction(travelCostFunction), graph(graph) { }	
 			
 
 																  // Returns the value of the objective function for the specified edge flows.
-																  double operator()(const std::vector<double>& flows) const {
-		double sum = 0;
-	
-		for (int e = 0; e < flows.size(); ++e)
-			sum += travelCostFunction.integral(e, flows[e]);
-			
-		return sum;
+																  double operator()(const std::vector<EdgeValue>& flows) const {
+		return sumOverEdgeRangeByClass(travelCostFunction, 0, flows.size(), flows.data(), [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).value(e, x);
+		});
 	}
 
 	// Returns the weight of edge e, given the flow x on e.
 	double derivative(const int e, const double x) const {
-		return travelCostFunction(e, x);
+		return travelCostFunction.withKernelOf(e, [this, e, x](const auto& cost) {
+			return objectiveKernel(*this, cost).derivative(e, x);
+		});
 	}
 
 	// Returns the weight of edge e, given the flow x on e.
 	double secondDerivative(const int e, const double x) const {
-		return travelCostFunction.derivative(e, x);
+		return travelCostFunction.withKernelOf(e, [this, e, x](const auto& cost) {
+			return objectiveKernel(*this, cost).secondDerivative(e, x);
+		});
+	}
+
+	// Writes the weight of edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(travelCostFunction, first, last, x, out, [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).derivative(e, x);
+		});
+	}
+
+	// Writes the second derivative at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(travelCostFunction, first, last, x, out, [this](const auto& cost, const int e, const auto& x) {
+			return objectiveKernel(*this, cost).secondDerivative(e, x);
+		});
+	}
+
+	// Returns the weight of the SO objective function in this objective function.
+	static constexpr double systemOptimumWeight() {
+		return 0;
+	}
+
+	// Returns the contribution of edge e (or edges e, ..., e + 3) with the travel cost function cost
+	// to the objective function value at x.
+	template <typename CostT, typename ValueT>
+	static ValueT value(const CostT& cost, const int e, const ValueT& x) {
+		return cost.integral(e, x);
+	}
+
+	// Returns the weight of edge e (or edges e, ..., e + 3) with the travel cost function cost at x.
+	template <typename CostT, typename ValueT>
+	static ValueT derivative(const CostT& cost, const int e, const ValueT& x) {
+		return cost(e, x);
+	}
+
+	// Returns the second derivative for edge e (or edges e, ..., e + 3) with the travel cost function cost at x.
+	template <typename CostT, typename ValueT>
+	static ValueT secondDerivative(const CostT& cost, const int e, const ValueT& x) {
+		return cost.derivative(e, x);
 	}
 
 private:
 	TravelCostFunctionT travelCostFunction; // A functor returning the travel cost on an edge.
-	Graph& graph;
+	const Graph& graph;
 };
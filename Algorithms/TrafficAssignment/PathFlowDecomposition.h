@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+// A decomposition of the Frank-Wolfe solution into path flows. For each OD-pair, it keeps the set of
+// distinct paths found by the all-or-nothing assignments so far, together with the share of the
+// pair's volume that the current solution x and the search direction s (the point of sight in
+// conjugate Frank-Wolfe) send along each path. The shares are updated in place whenever x or s is
+// updated, so the memory grows with the number of distinct paths rather than the number of
+// iterations. Paths are deduplicated by comparing hashes before comparing edges.
+class PathFlowDecomposition {
+public:
+	// Constructs an empty decomposition for the specified number of OD-pairs.
+	explicit PathFlowDecomposition(const int numPairs) : pathsOfPair(numPairs) {}
+
+	// Sets s to alpha * s + (1 - alpha) * y, where y sends each OD-pair along the specified path.
+	void updateDirection(const std::vector<std::list<int>>& newPaths, const double alpha) {
+		assert(newPaths.size() == pathsOfPair.size());
+		for (auto& path : paths)
+			path.directionShare *= alpha;
+		for (int i = 0; i < newPaths.size(); ++i)
+			paths[findOrInsert(i, newPaths[i])].directionShare += 1 - alpha;
+	}
+
+	// Sets x to (1 - tau) * x + tau * s.
+	void moveAlongDirection(const double tau) {
+		for (auto& path : paths)
+			path.share = (1 - tau) * path.share + tau * path.directionShare;
+	}
+
+	// Returns the number of distinct paths.
+	int numPaths() const {
+		return paths.size();
+	}
+
+	// Returns the total number of edges on the distinct paths.
+	int64_t numPathEdges() const {
+		return pathEdges.size();
+	}
+
+	// Calls visit(path, share) for each distinct path of the i-th OD-pair, where path is a pair of
+	// pointers to the first and past-the-end edge and share is the fraction of the pair's volume
+	// that the current solution sends along the path.
+	template <typename VisitorT>
+	void forEachPath(const int i, VisitorT visit) const {
+		assert(i >= 0); assert(i < pathsOfPair.size());
+		for (const int p : pathsOfPair[i])
+		{
+			const int32_t* const first = pathEdges.data() + paths[p].firstEdge;
+			visit(first, first + paths[p].numEdges, paths[p].share);
+		}
+	}
+
+private:
+	// A distinct path of an OD-pair.
+	struct Path {
+		uint64_t hash;         // The hash of the edge sequence.
+		int64_t firstEdge;     // The index of the first edge in pathEdges.
+		int32_t numEdges;      // The number of edges on the path.
+		double share;          // The share of the pair's volume in x.
+		double directionShare; // The share of the pair's volume in s.
+	};
+
+	// Returns the FNV-1a hash of the specified edge sequence.
+	static uint64_t hashOf(const std::list<int>& path) {
+		uint64_t hash = 14695981039346656037ull;
+		for (const int e : path)
+		{
+			hash ^= static_cast<uint32_t>(e);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Returns the index of the specified path of the i-th OD-pair, inserting it if it is new.
+	int findOrInsert(const int i, const std::list<int>& path) {
+		const uint64_t hash = hashOf(path);
+		for (const int p : pathsOfPair[i])
+			if (paths[p].hash == hash && paths[p].numEdges == path.size() &&
+				std::equal(path.begin(), path.end(), pathEdges.begin() + paths[p].firstEdge))
+				return p;
+
+		pathsOfPair[i].push_back(paths.size());
+		paths.push_back({hash, static_cast<int64_t>(pathEdges.size()), static_cast<int32_t>(path.size()), 0, 0});
+		pathEdges.insert(pathEdges.end(), path.begin(), path.end());
+		return paths.size() - 1;
+	}
+
+	std::vector<std::vector<int>> pathsOfPair; // The indices of the distinct paths of each OD-pair.
+	std::vector<Path> paths;                   // The distinct paths of all OD-pairs.
+	std::vector<int32_t> pathEdges;            // The edges on the distinct paths, path after path.
+};
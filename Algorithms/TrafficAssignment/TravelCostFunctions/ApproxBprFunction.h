@@ -1,126 +1,149 @@
 #pragma once
 
+#include <algorithm>
+
 #include <vectorclass/vectorclass.h>
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
 #include "Algorithms/TrafficAssignment/TravelCostFunctions/BprFunction.h"
-#include "Algorithms/TrafficAssignment/TravelCostFunctions/CustomBprFunction.h"
+#include "DataStructures/Graph/Graph.h"
+#include "Tools/Simd/AlignedVector.h"
 
-// The BPR travel cost function, relating the travel time on an edge to the flow on this edge.
-template <typename GraphT>
+// A piecewise linear approximation of the BPR function in the presence of exogenous flow x0. On a
+// road edge, the travel time stays at its value for the exogenous flow alone until the total flow
+// x + x0 reaches XTH times the capacity. Beyond, it grows with the slope of the secant of the BPR
+// function between XTH and XEND times the capacity. The value for x0, the slope and the breakpoint
+// (in terms of the assigned flow x) are precomputed for each edge.
 class ApproxBprFunction {
- public:
-  // Constructs a BPR function.
-	ApproxBprFunction(const GraphT& graph) : graph(graph), bpr(graph), cbpr(graph) {
-		exo = graph.exogenous();
-		dummy_id = graph.dummyId();
-		exo_v = Vec4d(exo);
+public:
+	// The approximation c + s * max(x - p, 0) on road edges. The methods evaluate edge e at a double
+	// x or edges e, ..., e + 3 at a Vec4d x.
+	class RoadKernel {
+	public:
+		RoadKernel(const double* intercept, const double* slope, const double* breakpoint)
+			: intercept(intercept), slope(slope), breakpoint(breakpoint) {}
+
+		// Returns the travel time on edge e, given the flow x on e.
+		template <typename ValueT>
+		ValueT operator()(const int e, const ValueT& x) const {
+			const ValueT p = loadEdgeValues<ValueT>(breakpoint, e);
+			const ValueT excess = choose(x > p, x - p, ValueT(0));
+			return loadEdgeValues<ValueT>(intercept, e) + loadEdgeValues<ValueT>(slope, e) * excess;
+		}
+
+		// Returns the derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT derivative(const int e, const ValueT& x) const {
+			return choose(x > loadEdgeValues<ValueT>(breakpoint, e), loadEdgeValues<ValueT>(slope, e), ValueT(0));
+		}
+
+		// Returns the second derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT secondDerivative(const int /*e*/, const ValueT& /*x*/) const {
+			return ValueT(0);
+		}
+
+		// Returns the integral of e's travel cost function from 0 to b.
+		template <typename ValueT>
+		ValueT integral(const int e, const ValueT& b) const {
+			const ValueT p = loadEdgeValues<ValueT>(breakpoint, e);
+			const ValueT excessAtB = choose(b > p, b - p, ValueT(0));
+			const ValueT excessAtZero = choose(p < 0, -p, ValueT(0));
+			return loadEdgeValues<ValueT>(intercept, e) * b +
+				loadEdgeValues<ValueT>(slope, e) * (excessAtB * excessAtB - excessAtZero * excessAtZero) / 2;
+		}
+
+	private:
+		const double* intercept;  // The travel time for the exogenous flow alone.
+		const double* slope;      // The slope beyond the breakpoint.
+		const double* breakpoint; // The assigned flow at which the travel time starts to grow.
+	};
+
+	// Constructs an approximate BPR function.
+	ApproxBprFunction(const Graph& graph)
+		: graph(graph), demand(graph), coefficients(NUM_ROWS * graph.numEdges()) {
+		const BprFunction bpr(graph);
+		const int m = graph.numEdges();
+		for (int e = graph.edgeClassBegin(Graph::ROAD_EDGE_BETA4); e < graph.edgeClassEnd(Graph::ROAD_EDGE); ++e)
+		{
+			const double cap = graph.capacity(e);
+			const double x0 = graph.coefficient(Graph::EXOGENOUS_FLOW, e);
+			coefficients[INTERCEPT * m + e] = bpr(e, x0);
+			coefficients[SLOPE * m + e] = (bpr(e, XEND * cap) - bpr(e, XTH * cap)) / ((XEND - XTH) * cap);
+			coefficients[BREAKPOINT * m + e] = XTH * cap - x0;
+		}
+	}
+
+	// Returns the travel time on edge e, given the flow x on e.
+	double operator()(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost(e, x); });
+	}
+
+	// Returns the derivative of e's travel cost function at x.
+	double derivative(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.derivative(e, x); });
+	}
+
+	// Returns the second derivative of e's travel cost function at x.
+	double secondDerivative(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.secondDerivative(e, x); });
+	}
+
+	// Returns the integral of e's travel cost function from 0 to b.
+	double integral(const int e, const double b) const {
+		return withKernelOf(e, [e, b](const auto& cost) { return cost.integral(e, b); });
+	}
+
+	// Returns f(kernel), where kernel evaluates the travel cost function of e's class.
+	template <typename FunctionT>
+	double withKernelOf(const int e, FunctionT f) const {
+		return graph.edgeClass(e) == Graph::DEMAND_EDGE ? f(demand) : f(road());
+	}
+
+	// Calls visit(begin, end, kernel) for the part [begin, end) of [first, last) covered by the road
+	// edges and by the demand edges, where kernel evaluates their travel cost function without branches.
+	template <typename VisitorT>
+	void forEachEdgeClass(const int first, const int last, VisitorT visit) const {
+		const int roadEnd = graph.edgeClassEnd(Graph::ROAD_EDGE);
+		if (first < std::min(roadEnd, last))
+			visit(first, std::min(roadEnd, last), road());
+		if (std::max(roadEnd, first) < last)
+			visit(std::max(roadEnd, first), last, demand);
+	}
+
+	// Writes the travel time on edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void evaluate(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost(e, x);
+		});
+	}
+
+	// Writes the derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.derivative(e, x);
+		});
+	}
+
+	// Writes the second derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.secondDerivative(e, x);
+		});
+	}
+
+private:
+	// The precomputed rows of coefficients.
+	enum Row { INTERCEPT, SLOPE, BREAKPOINT, NUM_ROWS };
+
+	// Returns the kernel of road edges.
+	RoadKernel road() const {
+		const int m = graph.numEdges();
+		const double* const rows = coefficients.data();
+		return RoadKernel(rows + INTERCEPT * m, rows + SLOPE * m, rows + BREAKPOINT * m);
 	}
 
-  // Returns the travel time on edge e, given the flow x on e.
-  double operator()(const int e, const double x) const {
-	  double x_new;
-	  const double cap = graph.capacity(e);
-	  
-	  if (graph.edgeReal(e))
-	  {
-		  x_new = x + exo*cap;
-		  const double pt = XTH * cap;
-		  if (x_new <= pt)
-			  return bpr(e, exo*cap);
-		  else
-		  {
-			  double b_slope = (bpr(e, 2*cap) - bpr(e, pt)) / (2*cap - pt);
-			  double cost =  b_slope * (x_new - pt) +  bpr(e, exo*cap);
-			  return cost;
-		  }
-	  }
-	  else
-	  {
-		  x_new = x;
-		  const double pt = APT * cap;
-		  if (x_new <= pt)
-			  return bpr(e, x_new);
-		  else
-			  return bpr(e, pt) + bpr.derivative(e, pt) * (x_new - pt);
-	  }
-  }
-
-  // Returns the derivative of e's travel cost function at x.
-  double derivative(const int e, const double x) const {
-	  double x_new;
-	  const double cap = graph.capacity(e);
-	  if (graph.edgeReal(e))
-	  {
-		  x_new = x + exo*cap;
-		  const double pt =XTH * cap;
-		  if (x <= pt)
-			  return 0.0;
-		  else
-		  {
-			  double b_slope = (bpr(e, 2*cap) - bpr(e, pt)) / (2*cap - pt);
-			  return b_slope;
-		  }
-	  }
-	  else
-	  {
-		  x_new = x;
-		  const double pt = APT * graph.capacity(e); // The point at which we linearize.
-		  if (x_new <= pt)
-			  return bpr.derivative(e, x_new);
-		  else
-			  return bpr.derivative(e, pt);
-	  }	  
-  }
-
-  // Returns the integral of e's travel cost function from 0 to b.
-  double integral(const int e, const double b) const {
-	  // this is not supposed to happen
-	  std::cout << "INTEGRAL OF APPROXBPR IS USED " << b << e << std::endl;	  
-	  return 0.0;
-  }
-
-  // Returns the travel times on four consecutive edges starting at e, given the flows x on them.
-  Vec4d operator()(const int e, const Vec4d& x) const {
-	  const double cap = graph.capacity(e);
-	  const Vec4d cap_v(cap);
-	  Vec4d edgeReal, edgeFake;
-	  edgeReal.load(&graph.edgeReal(e));
-	  edgeFake.load(&graph.edgeFake(e));
-	  Vec4d val_fake = cbpr(e,x)*edgeFake;
-
-	  Vec4d x_new;
-	  x_new = x + exo_v*cap_v;
-
-	  Vec4d pt_real = XTH * cap_v;
-	  Vec4d slope = (bpr(e,2*cap_v)-bpr(e,pt_real))/(2*cap-pt_real);
-	  Vec4d val_real = (bpr(e, exo_v*cap_v) + slope * (max(x_new, pt_real) - pt_real)) * edgeReal;
-	  
-	  return val_fake + val_real;
-  }
-
-  // Returns the derivative of e's travel cost function at x.
-  Vec4d derivative(const int e, const Vec4d& x) const{
-	  const double cap = graph.capacity(e);
-	  const Vec4d cap_v(cap);
-	  Vec4d edgeReal, edgeFake;
-	  edgeReal.load(&graph.edgeReal(e));
-	  edgeFake.load(&graph.edgeFake(e));
-	  Vec4d val_fake = cbpr.derivative(e,x)*edgeFake;
-
-	  Vec4d x_new;
-	  x_new = x + exo_v*cap_v;
-	  Vec4d pt_real = XTH * cap_v;
-	  Vec4d slope = (bpr(e,2*cap_v)-bpr(e,pt_real))/(2*cap-pt_real);
-	  Vec4d val_real = slope *  ((min(x_new,pt_real)-x_new) / (pt_real-x_new)) * edgeReal;
-
-	  return val_fake + val_real; 
-  }
-
-
-  private:
-	const GraphT& graph; // The graph on whose edges we operate.
-	BprFunction<GraphT> bpr; // The original BPR function.
-	CustomBprFunction<GraphT> cbpr; // The original BPR function.
-	double exo;
-	int dummy_id;
-	Vec4d exo_v;
+	const Graph& graph;                 // The graph on whose edges we operate.
+	BprFunction::DemandKernel demand;   // The travel cost function of the demand edges.
+	AlignedVector<double> coefficients; // The precomputed rows, one after another.
 };
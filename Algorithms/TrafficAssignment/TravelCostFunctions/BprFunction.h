@@ -1,5 +1,12 @@
 #pragma once
 
+#include <algorithm>
+
+#include <vectorclass/vectorclass.h>
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
+#include "DataStructures/Graph/Graph.h"
+
 #define APT 3.0 // Global linearization point
 #define XTH 1.2
 #define XEND 2
@@ -7,56 +14,256 @@
 // The BPR travel cost function, relating the travel time on an edge to the flow on this edge.
 class BprFunction {
 public:
+	// The BPR function t0 + c * x^BETA on road edges whose exponent BETA is a small integer. The
+	// methods evaluate edge e at a double x or edges e, ..., e + 3 at a Vec4d x.
+	template <int BETA>
+	class RoadKernel {
+	public:
+		explicit RoadKernel(const Graph& graph)
+			: freeFlowTime(graph.coefficients(Graph::FREE_FLOW_TIME)), slope(graph.coefficients(Graph::BPR_SLOPE)) {}
+
+		// Returns the travel time on edge e, given the flow x on e.
+		template <typename ValueT>
+		ValueT operator()(const int e, const ValueT& x) const {
+			return loadEdgeValues<ValueT>(freeFlowTime, e) + loadEdgeValues<ValueT>(slope, e) * integerPower<BETA>(x);
+		}
+
+		// Returns the derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT derivative(const int e, const ValueT& x) const {
+			return loadEdgeValues<ValueT>(slope, e) * BETA * integerPower<BETA - 1>(x);
+		}
+
+		// Returns the second derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT secondDerivative(const int e, const ValueT& x) const {
+			return loadEdgeValues<ValueT>(slope, e) * BETA * (BETA - 1) * integerPower<BETA - 2>(x);
+		}
+
+		// Returns the integral of e's travel cost function from 0 to b.
+		template <typename ValueT>
+		ValueT integral(const int e, const ValueT& b) const {
+			return loadEdgeValues<ValueT>(freeFlowTime, e) * b + loadEdgeValues<ValueT>(slope, e) * integerPower<BETA + 1>(b) / (BETA + 1);
+		}
+
+		// Returns the free-flow travel time t0 of edge e (or of edges e, ..., e + 3).
+		template <typename ValueT>
+		ValueT freeFlowTimeOf(const int e) const {
+			return loadEdgeValues<ValueT>(freeFlowTime, e);
+		}
+
+		// Returns the coefficient c of x^BETA for edge e (or for edges e, ..., e + 3).
+		template <typename ValueT>
+		ValueT slopeOf(const int e) const {
+			return loadEdgeValues<ValueT>(slope, e);
+		}
+
+	private:
+		const double* freeFlowTime; // The free-flow travel time of each edge.
+		const double* slope;        // The coefficient of x^BETA for each edge.
+	};
+
+	// The BPR function t0 + c * x^beta on road edges with any other exponent beta >= 1, which is
+	// read per edge and evaluated with a (vectorized) pow.
+	class GeneralRoadKernel {
+	public:
+		explicit GeneralRoadKernel(const Graph& graph)
+			: freeFlowTime(graph.coefficients(Graph::FREE_FLOW_TIME)),
+			  slope(graph.coefficients(Graph::BPR_SLOPE)),
+			  exponent(graph.coefficients(Graph::BPR_EXPONENT)) {}
+
+		// Returns the travel time on edge e, given the flow x on e.
+		template <typename ValueT>
+		ValueT operator()(const int e, const ValueT& x) const {
+			return loadEdgeValues<ValueT>(freeFlowTime, e) + loadEdgeValues<ValueT>(slope, e) * power(x, loadEdgeValues<ValueT>(exponent, e));
+		}
+
+		// Returns the derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT derivative(const int e, const ValueT& x) const {
+			const ValueT beta = loadEdgeValues<ValueT>(exponent, e);
+			return loadEdgeValues<ValueT>(slope, e) * beta * power(x, beta - 1);
+		}
+
+		// Returns the second derivative of e's travel cost function at x. For beta < 2, it is taken
+		// to be zero at x = 0, where it does not exist.
+		template <typename ValueT>
+		ValueT secondDerivative(const int e, const ValueT& x) const {
+			const ValueT beta = loadEdgeValues<ValueT>(exponent, e);
+			const ValueT value = loadEdgeValues<ValueT>(slope, e) * beta * (beta - 1) * power(x, beta - 2);
+			return choose(x > 0, value, ValueT(0));
+		}
+
+		// Returns the integral of e's travel cost function from 0 to b.
+		template <typename ValueT>
+		ValueT integral(const int e, const ValueT& b) const {
+			const ValueT beta = loadEdgeValues<ValueT>(exponent, e);
+			return loadEdgeValues<ValueT>(freeFlowTime, e) * b + loadEdgeValues<ValueT>(slope, e) * power(b, beta + 1) / (beta + 1);
+		}
+
+		// Returns the free-flow travel time t0 of edge e (or of edges e, ..., e + 3).
+		template <typename ValueT>
+		ValueT freeFlowTimeOf(const int e) const {
+			return loadEdgeValues<ValueT>(freeFlowTime, e);
+		}
+
+		// Returns the coefficient c of x^beta for edge e (or for edges e, ..., e + 3).
+		template <typename ValueT>
+		ValueT slopeOf(const int e) const {
+			return loadEdgeValues<ValueT>(slope, e);
+		}
+
+		// Returns the exponent beta of edge e (or of edges e, ..., e + 3).
+		template <typename ValueT>
+		ValueT exponentOf(const int e) const {
+			return loadEdgeValues<ValueT>(exponent, e);
+		}
+
+	private:
+		const double* freeFlowTime; // The free-flow travel time of each edge.
+		const double* slope;        // The coefficient of x^beta for each edge.
+		const double* exponent;     // The exponent beta of each edge.
+	};
+
+	// The inverse demand function slope * x + intercept on demand edges.
+	class DemandKernel {
+	public:
+		explicit DemandKernel(const Graph& graph)
+			: slope(graph.coefficients(Graph::DEMAND_SLOPE)), intercept(graph.coefficients(Graph::DEMAND_INTERCEPT)) {}
+
+		// Returns the travel cost on edge e, given the flow x on e.
+		template <typename ValueT>
+		ValueT operator()(const int e, const ValueT& x) const {
+			return loadEdgeValues<ValueT>(slope, e) * x + loadEdgeValues<ValueT>(intercept, e);
+		}
+
+		// Returns the derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT derivative(const int e, const ValueT& /*x*/) const {
+			return loadEdgeValues<ValueT>(slope, e);
+		}
+
+		// Returns the second derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT secondDerivative(const int /*e*/, const ValueT& /*x*/) const {
+			return ValueT(0);
+		}
+
+		// Returns the integral of e's travel cost function from 0 to b.
+		template <typename ValueT>
+		ValueT integral(const int e, const ValueT& b) const {
+			return loadEdgeValues<ValueT>(slope, e) * b * b + loadEdgeValues<ValueT>(intercept, e) * b;
+		}
+
+		// Returns the slope of the inverse demand function of edge e (or of edges e, ..., e + 3).
+		template <typename ValueT>
+		ValueT slopeOf(const int e) const {
+			return loadEdgeValues<ValueT>(slope, e);
+		}
+
+		// Returns the intercept of the inverse demand function of edge e (or of edges e, ..., e + 3).
+		template <typename ValueT>
+		ValueT interceptOf(const int e) const {
+			return loadEdgeValues<ValueT>(intercept, e);
+		}
+
+	private:
+		const double* slope;     // The slope of the inverse demand function of each edge.
+		const double* intercept; // The intercept of the inverse demand function of each edge.
+	};
+
 	// Constructs a BPR function.
-	BprFunction(const Graph& graph) : graph(graph) {}
+	BprFunction(const Graph& graph) : graph(graph), road4(graph), road5(graph), road6(graph), road(graph), demand(graph) {}
 
 	// Returns the travel time on edge e, given the flow x on e.
 	double operator()(const int e, const double x) const {
-		if (isDemandEdge(e))
-			return graph.length(e) * x * 0.5 + graph.speed(e);		
-		
-		const double tmp = x / graph.capacity(e);
-		return graph.freeTravelTime(e) * (1 + 0.15 * tmp * tmp * tmp * tmp);
+		return withKernelOf(e, [e, x](const auto& cost) { return cost(e, x); });
 	}
 
 	// Returns the derivative of e's travel cost function at x.
 	double derivative(const int e, const double x) const {
-		if (isDemandEdge(e))
-			return graph.length(e) *  0.5;
-		
-		const double tmp = x / graph.capacity(e);
-		return graph.freeTravelTime(e) * 0.15 * 4 * tmp * tmp * tmp / graph.capacity(e);
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.derivative(e, x); });
 	}
 
 	// Returns the derivative of e's travel cost function at x.
 	double secondDerivative(const int e, const double x) const {
-		if (isDemandEdge(e))
-			return 0.0;
-		
-		const double tmp = x / graph.capacity(e);
-		return graph.freeTravelTime(e) * 0.15 * 4 * 3 * tmp * tmp / (graph.capacity(e) * graph.capacity(e));
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.secondDerivative(e, x); });
 	}
-	
+
 	// Returns the antiderivative of e's travel cost function at x.
 	double antiderivative(const int e, const double x) const {
-		const double tmp = x / graph.capacity(e);
-		return graph.freeTravelTime(e) * (x + 0.15 * x * tmp * tmp * tmp * tmp / (4 + 1));
+		return integral(e, x);
 	}
 
 	// Returns the integral of e's travel cost function from 0 to b.
 	double integral(const int e, const double b) const {
-		if (isDemandEdge(e))
-			return graph.length(e) * b * b * 0.5 + graph.speed(e) * b;		
+		return withKernelOf(e, [e, b](const auto& cost) { return cost.integral(e, b); });
+	}
 
-		return antiderivative(e, b) - antiderivative(e, 0);
+	// Returns f(kernel), where kernel evaluates the travel cost function of e's class.
+	template <typename FunctionT>
+	double withKernelOf(const int e, FunctionT f) const {
+		switch (graph.edgeClass(e))
+		{
+		case Graph::ROAD_EDGE_BETA4:
+			return f(road4);
+		case Graph::ROAD_EDGE_BETA5:
+			return f(road5);
+		case Graph::ROAD_EDGE_BETA6:
+			return f(road6);
+		case Graph::ROAD_EDGE:
+			return f(road);
+		default:
+			return f(demand);
+		}
 	}
-	
-	// Returns true if the current edge represent the inverse demand function D^-1(d^max - x), and so needs to be computed differently
-	bool isDemandEdge(const int e) const 
-	{
-		return graph.capacity(e) == 0;
+
+	// Calls visit(begin, end, kernel) for the part [begin, end) of [first, last) covered by each
+	// edge class, where kernel evaluates the travel cost function of that class without branches.
+	template <typename VisitorT>
+	void forEachEdgeClass(const int first, const int last, VisitorT visit) const {
+		visitEdgeClass(Graph::ROAD_EDGE_BETA4, first, last, road4, visit);
+		visitEdgeClass(Graph::ROAD_EDGE_BETA5, first, last, road5, visit);
+		visitEdgeClass(Graph::ROAD_EDGE_BETA6, first, last, road6, visit);
+		visitEdgeClass(Graph::ROAD_EDGE, first, last, road, visit);
+		visitEdgeClass(Graph::DEMAND_EDGE, first, last, demand, visit);
+	}
+
+	// Writes the travel time on edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void evaluate(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost(e, x);
+		});
+	}
+
+	// Writes the derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.derivative(e, x);
+		});
 	}
-	
-private:	
-	const Graph& graph; // The graph on whose edges we operate.
+
+	// Writes the second derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.secondDerivative(e, x);
+		});
+	}
+
+private:
+	// Calls visit(begin, end, kernel) for the part [begin, end) of [first, last) covered by class c.
+	template <typename KernelT, typename VisitorT>
+	void visitEdgeClass(const Graph::EdgeClass c, const int first, const int last, const KernelT& kernel, VisitorT& visit) const {
+		const int begin = std::max(graph.edgeClassBegin(c), first);
+		const int end = std::min(graph.edgeClassEnd(c), last);
+		if (begin < end)
+			visit(begin, end, kernel);
+	}
+
+	const Graph& graph;     // The graph on whose edges we operate.
+	RoadKernel<4> road4;    // The travel cost function of the road edges with exponent 4.
+	RoadKernel<5> road5;    // The travel cost function of the road edges with exponent 5.
+	RoadKernel<6> road6;    // The travel cost function of the road edges with exponent 6.
+	GeneralRoadKernel road; // The travel cost function of the other road edges.
+	DemandKernel demand;    // The travel cost function of the demand edges.
 };
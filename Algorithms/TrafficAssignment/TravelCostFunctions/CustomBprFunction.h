@@ -1,110 +1,134 @@
 #pragma once
 
 #include <vectorclass/vectorclass.h>
-#include "Algorithms/TrafficAssignment/TravelCostFunctions/BprFunction.h"
 
-// The BPR travel cost function, relating the travel time on an edge to the flow on this edge.
-template <typename GraphTT>
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
+#include "Algorithms/TrafficAssignment/TravelCostFunctions/ModifiedBprFunction.h"
+#include "DataStructures/Graph/Graph.h"
+#include "Tools/Simd/AlignedVector.h"
+
+// The modified BPR function, evaluated at the assigned flow plus the exogenous flow on each edge.
+// The exogenous flow shifts the argument of the function, and the integral of the shifted function
+// from 0 to b is the integral of the modified BPR function from x0 to x0 + b. The integrals up to
+// the exogenous flows x0 are precomputed.
 class CustomBprFunction {
- public:
-  // Constructs a BPR function.
-	CustomBprFunction(const GraphTT& graph) : graph(graph), bpr(graph) {
-		exo = graph.exogenous();
-		dummy_id = graph.dummyId();
-		exo_v = Vec4d(exo);
+public:
+	// A kernel on road edges, evaluating a modified BPR kernel at x + x0. The methods evaluate edge
+	// e at a double x or edges e, ..., e + 3 at a Vec4d x.
+	template <typename KernelT>
+	class RoadKernel {
+	public:
+		RoadKernel(const KernelT& cost, const double* exogenousFlow, const double* exogenousIntegral)
+			: cost(cost), exogenousFlow(exogenousFlow), exogenousIntegral(exogenousIntegral) {}
+
+		// Returns the travel time on edge e, given the flow x on e.
+		template <typename ValueT>
+		ValueT operator()(const int e, const ValueT& x) const {
+			return cost(e, x + loadEdgeValues<ValueT>(exogenousFlow, e));
+		}
+
+		// Returns the derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT derivative(const int e, const ValueT& x) const {
+			return cost.derivative(e, x + loadEdgeValues<ValueT>(exogenousFlow, e));
+		}
+
+		// Returns the second derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT secondDerivative(const int e, const ValueT& x) const {
+			return cost.secondDerivative(e, x + loadEdgeValues<ValueT>(exogenousFlow, e));
+		}
+
+		// Returns the integral of e's travel cost function from 0 to b.
+		template <typename ValueT>
+		ValueT integral(const int e, const ValueT& b) const {
+			const ValueT x0 = loadEdgeValues<ValueT>(exogenousFlow, e);
+			return cost.integral(e, b + x0) - loadEdgeValues<ValueT>(exogenousIntegral, e);
+		}
+
+	private:
+		const KernelT cost;               // The modified BPR kernel.
+		const double* exogenousFlow;      // The exogenous flow on each edge.
+		const double* exogenousIntegral;  // The integral of the modified BPR function up to x0.
+	};
+
+	// Constructs a BPR function that accounts for the exogenous flows.
+	CustomBprFunction(const Graph& graph)
+		: modifiedBpr(graph), exogenousFlow(graph.coefficients(Graph::EXOGENOUS_FLOW)),
+		  exogenousIntegral(graph.numEdges()) {
+		FORALL_EDGES(graph, e)
+			exogenousIntegral[e] = modifiedBpr.integral(e, graph.coefficient(Graph::EXOGENOUS_FLOW, e));
+	}
+
+	// Returns the travel time on edge e, given the flow x on e.
+	double operator()(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost(e, x); });
+	}
+
+	// Returns the derivative of e's travel cost function at x.
+	double derivative(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.derivative(e, x); });
+	}
+
+	// Returns the second derivative of e's travel cost function at x.
+	double secondDerivative(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.secondDerivative(e, x); });
+	}
+
+	// Returns the integral of e's travel cost function from 0 to b.
+	double integral(const int e, const double b) const {
+		return withKernelOf(e, [e, b](const auto& cost) { return cost.integral(e, b); });
+	}
+
+	// Returns f(kernel), where kernel evaluates the travel cost function of e's class.
+	template <typename FunctionT>
+	double withKernelOf(const int e, FunctionT f) const {
+		return modifiedBpr.withKernelOf(e, [&](const auto& kernel) { return f(shift(kernel)); });
+	}
+
+	// Calls visit(begin, end, kernel) for the part [begin, end) of [first, last) covered by each
+	// edge class, where kernel evaluates the travel cost function of that class without branches.
+	template <typename VisitorT>
+	void forEachEdgeClass(const int first, const int last, VisitorT visit) const {
+		modifiedBpr.forEachEdgeClass(first, last, [&](const int begin, const int end, const auto& kernel) {
+			visit(begin, end, shift(kernel));
+		});
+	}
+
+	// Writes the travel time on edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void evaluate(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost(e, x);
+		});
+	}
+
+	// Writes the derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.derivative(e, x);
+		});
+	}
+
+	// Writes the second derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.secondDerivative(e, x);
+		});
+	}
+
+private:
+	// Returns the shifted kernel for the specified modified BPR kernel of road edges.
+	template <typename KernelT>
+	RoadKernel<KernelT> shift(const KernelT& kernel) const {
+		return RoadKernel<KernelT>(kernel, exogenousFlow, exogenousIntegral.data());
+	}
+
+	// Returns the kernel of demand edges, which carry no exogenous flow.
+	const BprFunction::DemandKernel& shift(const BprFunction::DemandKernel& demandKernel) const {
+		return demandKernel;
 	}
 
-  // Returns the travel time on edge e, given the flow x on e.
-  double operator()(const int e, const double x) const {
-	  double x_new;
-	  const double cap = graph.capacity(e);
-	  
-	  if (graph.edgeReal(e))
-		  x_new = x + exo*cap;
-	  else
-		  x_new = x;
-	  const double pt = APT * cap;
-	  if (x <= pt)
-		  return bpr(e, x_new);
-	  else
-		  return bpr(e, pt) + bpr.derivative(e, pt) * (x_new - pt);
-  }
-
-  // Returns the derivative of e's travel cost function at x.
-  double derivative(const int e, const double x) const {
-	  double x_new;
-	  const double cap = graph.capacity(e);
-	  if (graph.edgeReal(e))
-		  x_new = x + exo*cap;
-	  else
-		  x_new = x;
-
-	  const double pt = APT * graph.capacity(e); // The point at which we linearize.
-	  if (x_new <= pt)
-		  return bpr.derivative(e, x_new);
-	  else
-		  return bpr.derivative(e, pt);
-  }
-
-  // Returns the integral of e's travel cost function from 0 to b.
-  double integral(const int e, const double b) const {
-	double b_new;
-	const double cap = graph.capacity(e);
-	
-	if (graph.edgeReal(e))
-	  b_new = b + exo*cap;
-	else
-	  b_new = b;
-	
-    const double pt = APT * graph.capacity(e); // The point at which we linearize.
-	double int_old, int_new;
-	
-    if (b_new <= pt)
-      int_new = bpr.integral(e, b_new);
-    else
-      int_new = bpr.integral(e, pt) + (b_new - pt) * (operator()(e, b_new) + operator()(e, pt)) / 2;
-
-	if (b <= pt)
-		int_old =  bpr.integral(e, b);
-	else
-		int_old = bpr.integral(e, pt) + (b - pt) * (operator()(e, b) + operator()(e, pt)) / 2;
-
-	return int_new - int_old;		
-  }
-
-  // Returns the travel times on four consecutive edges starting at e, given the flows x on them.
-  Vec4d operator()(const int e, const Vec4d& x) const {
-	  const double cap = graph.capacity(e);
-	  const Vec4d cap_v(cap);
-	  Vec4d edgeReal;
-	  edgeReal.load(&graph.edgeReal(e));
-	  
-	  Vec4d x_new;
-	  x_new = x + exo_v*cap_v*edgeReal;
-	  
-    Vec4d pt = APT * to_double(Vec4i().load(&graph.capacity(e)));
-    return bpr(e, min(x_new, pt)) +
-        bpr.derivative(e, pt) * (max(x_new, pt) - pt);
-  }
-
-  // Returns the derivative of e's travel cost function at x.
-  Vec4d derivative(const int e, const Vec4d& x) const{
-	  const double cap = graph.capacity(e);
-	  const Vec4d cap_v(cap);
-	  Vec4d edgeReal;
-	  edgeReal.load(&graph.edgeReal(e));
-	  
-	  Vec4d x_new;
-  	  x_new = x + (exo_v*cap_v)*edgeReal;
-	  
-	  Vec4d pt = APT * to_double(Vec4i().load(&graph.capacity(e)));
-	  return bpr.derivative(e, min(x_new, pt));
-  }
-
- private:
-	const GraphTT& graph; // The graph on whose edges we operate.
-	BprFunction<GraphTT> bpr; // The original BPR function.
-	double exo;
-	int dummy_id;
-	Vec4d exo_v;
+	ModifiedBprFunction modifiedBpr;         // The modified BPR function without exogenous flow.
+	const double* exogenousFlow;             // The exogenous flow on each edge.
+	AlignedVector<double> exogenousIntegral; // The integral of the modified BPR function up to x0.
 };
@@ -1,53 +1,132 @@
 #pragma once
 
+#include <vectorclass/vectorclass.h>
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
 #include "Algorithms/TrafficAssignment/TravelCostFunctions/BprFunction.h"
 
 // The BPR travel cost function, relating the travel time on an edge to the flow on this edge.
 class ModifiedBprFunction {
 public:
+	// A BPR kernel on road edges, linearized beyond APT times the capacity. The methods evaluate
+	// edge e at a double x or edges e, ..., e + 3 at a Vec4d x.
+	template <typename BprKernelT>
+	class RoadKernel {
+	public:
+		RoadKernel(const BprKernelT& bpr, const double* capacity) : bpr(bpr), capacity(capacity) {}
+
+		// Returns the travel time on edge e, given the flow x on e.
+		template <typename ValueT>
+		ValueT operator()(const int e, const ValueT& x) const {
+			const ValueT pt = linearizationPoint<ValueT>(e);
+			return choose(x > pt, bpr(e, pt) + bpr.derivative(e, pt) * (x - pt), bpr(e, x));
+		}
+
+		// Returns the derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT derivative(const int e, const ValueT& x) const {
+			const ValueT pt = linearizationPoint<ValueT>(e);
+			return bpr.derivative(e, choose(x > pt, pt, x));
+		}
+
+		// Returns the second derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT secondDerivative(const int e, const ValueT& x) const {
+			const ValueT pt = linearizationPoint<ValueT>(e);
+			return choose(x > pt, ValueT(0), bpr.secondDerivative(e, x));
+		}
+
+		// Returns the integral of e's travel cost function from 0 to b.
+		template <typename ValueT>
+		ValueT integral(const int e, const ValueT& b) const {
+			const ValueT pt = linearizationPoint<ValueT>(e);
+			return choose(b > pt, bpr.integral(e, pt) + (b - pt) * ((*this)(e, b) + bpr(e, pt)) / 2, bpr.integral(e, b));
+		}
+
+	private:
+		// Returns the point at which e's travel cost function is linearized.
+		template <typename ValueT>
+		ValueT linearizationPoint(const int e) const {
+			return APT * loadEdgeValues<ValueT>(capacity, e);
+		}
+
+		const BprKernelT& bpr;  // The original BPR function.
+		const double* capacity; // The capacity of each edge.
+	};
+
 	// Constructs a BPR function.
-	ModifiedBprFunction(const Graph& graph) : graph(graph), bpr(graph) {
+	ModifiedBprFunction(const Graph& graph) : bpr(graph), capacity(graph.coefficients(Graph::CAPACITY)) {
 	}
 
 	// Returns the travel time on edge e, given the flow x on e.
 	double operator()(const int e, const double x) const {
-
-		const double pt = APT * graph.capacity(e); // The point at which we		linearize.
-		if (x <= pt || bpr.isDemandEdge(e))
-			return bpr(e, x);
-		else
-			return bpr(e, pt) + bpr.derivative(e, pt) * (x - pt);
+		return withKernelOf(e, [e, x](const auto& cost) { return cost(e, x); });
 	}
 
 	// Returns the derivative of e's travel cost function at x.
 	double derivative(const int e, const double x) const {
-		const double pt = APT * graph.capacity(e); // The point at which we linearize.
-		if (x <= pt || bpr.isDemandEdge(e))
-			return bpr.derivative(e, x);
-		else
-			return bpr.derivative(e, pt);
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.derivative(e, x); });
 	}
 
 	// Returns the derivative of e's travel cost function at x.
 	double secondDerivative(const int e, const double x) const {
-		const double pt = APT * graph.capacity(e); // The point at which we linearize.
-		if (x <= pt || bpr.isDemandEdge(e))
-			return bpr.secondDerivative(e, x);
-		else
-			return 0;
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.secondDerivative(e, x); });
 	}
 
 	// Returns the integral of e's travel cost function from 0 to b.
 	double integral(const int e, const double b) const {
-		const double pt = APT * graph.capacity(e); // The point at which we linearize.
-		if (b <= pt || bpr.isDemandEdge(e))
-			return bpr.integral(e, b);
-		else
-			return bpr.integral(e, pt) + (b - pt) * (operator()(e, b) + operator()(e, pt)) / 2;
+		return withKernelOf(e, [e, b](const auto& cost) { return cost.integral(e, b); });
+	}
+
+	// Returns f(kernel), where kernel evaluates the travel cost function of e's class.
+	template <typename FunctionT>
+	double withKernelOf(const int e, FunctionT f) const {
+		return bpr.withKernelOf(e, [&](const auto& bprKernel) { return f(linearize(bprKernel)); });
+	}
+
+	// Calls visit(begin, end, kernel) for the part [begin, end) of [first, last) covered by each
+	// edge class, where kernel evaluates the travel cost function of that class without branches.
+	template <typename VisitorT>
+	void forEachEdgeClass(const int first, const int last, VisitorT visit) const {
+		bpr.forEachEdgeClass(first, last, [&](const int begin, const int end, const auto& bprKernel) {
+			visit(begin, end, linearize(bprKernel));
+		});
+	}
+
+	// Writes the travel time on edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void evaluate(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost(e, x);
+		});
+	}
+
+	// Writes the derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.derivative(e, x);
+		});
+	}
+
+	// Writes the second derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.secondDerivative(e, x);
+		});
 	}
 
 
 private:
-	const Graph& graph; // The graph on whose edges we operate.
-	BprFunction bpr; // The original BPR function.
+	// Returns the linearized kernel for the specified BPR kernel of road edges.
+	template <typename BprKernelT>
+	RoadKernel<BprKernelT> linearize(const BprKernelT& bprKernel) const {
+		return RoadKernel<BprKernelT>(bprKernel, capacity);
+	}
+
+	// Returns the kernel of demand edges, whose inverse demand function is not linearized.
+	const BprFunction::DemandKernel& linearize(const BprFunction::DemandKernel& demandKernel) const {
+		return demandKernel;
+	}
+
+	BprFunction bpr;        // The original BPR function.
+	const double* capacity; // The capacity of each edge.
 };
@@ -1,95 +1,120 @@
 #pragma once
 
+#include <algorithm>
+
 #include <vectorclass/vectorclass.h>
+
+#include "Algorithms/TrafficAssignment/EdgeRangeEvaluation.h"
 #include "Algorithms/TrafficAssignment/TravelCostFunctions/BprFunction.h"
-#include "Algorithms/TrafficAssignment/TravelCostFunctions/CustomBprFunction.h"
+#include "DataStructures/Graph/Graph.h"
+#include "Tools/Simd/AlignedVector.h"
 
-// The BPR travel cost function, relating the travel time on an edge to the flow on this edge.
-template <typename GraphT>
+// A travel cost function that is unaware of the assigned flow on road edges. The travel time on a
+// road edge is the BPR travel time for the exogenous flow alone, which is precomputed for each edge.
+// Demand edges keep their inverse demand function.
 class UnawareBprFunction {
- public:
-  // Constructs a BPR function.
-	UnawareBprFunction(const GraphT& graph) : graph(graph), bpr(graph), cbpr(graph) {
-		exo = graph.exogenous();
-		dummy_id = graph.dummyId();
-		exo_v = Vec4d(exo);
+public:
+	// The constant travel time on road edges. The methods evaluate edge e at a double x or edges e,
+	// ..., e + 3 at a Vec4d x.
+	class RoadKernel {
+	public:
+		explicit RoadKernel(const double* travelTime) : travelTime(travelTime) {}
+
+		// Returns the travel time on edge e, given the flow x on e.
+		template <typename ValueT>
+		ValueT operator()(const int e, const ValueT& /*x*/) const {
+			return loadEdgeValues<ValueT>(travelTime, e);
+		}
+
+		// Returns the derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT derivative(const int /*e*/, const ValueT& /*x*/) const {
+			return ValueT(0);
+		}
+
+		// Returns the second derivative of e's travel cost function at x.
+		template <typename ValueT>
+		ValueT secondDerivative(const int /*e*/, const ValueT& /*x*/) const {
+			return ValueT(0);
+		}
+
+		// Returns the integral of e's travel cost function from 0 to b.
+		template <typename ValueT>
+		ValueT integral(const int e, const ValueT& b) const {
+			return loadEdgeValues<ValueT>(travelTime, e) * b;
+		}
+
+	private:
+		const double* travelTime; // The travel time for the exogenous flow on each edge.
+	};
+
+	// Constructs a BPR function that is unaware of the assigned flow.
+	UnawareBprFunction(const Graph& graph) : graph(graph), demand(graph), travelTime(graph.numEdges()) {
+		const BprFunction bpr(graph);
+		for (int e = graph.edgeClassBegin(Graph::ROAD_EDGE_BETA4); e < graph.edgeClassEnd(Graph::ROAD_EDGE); ++e)
+			travelTime[e] = bpr(e, graph.coefficient(Graph::EXOGENOUS_FLOW, e));
+	}
+
+	// Returns the travel time on edge e, given the flow x on e.
+	double operator()(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost(e, x); });
+	}
+
+	// Returns the derivative of e's travel cost function at x.
+	double derivative(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.derivative(e, x); });
+	}
+
+	// Returns the second derivative of e's travel cost function at x.
+	double secondDerivative(const int e, const double x) const {
+		return withKernelOf(e, [e, x](const auto& cost) { return cost.secondDerivative(e, x); });
+	}
+
+	// Returns the integral of e's travel cost function from 0 to b.
+	double integral(const int e, const double b) const {
+		return withKernelOf(e, [e, b](const auto& cost) { return cost.integral(e, b); });
+	}
+
+	// Returns f(kernel), where kernel evaluates the travel cost function of e's class.
+	template <typename FunctionT>
+	double withKernelOf(const int e, FunctionT f) const {
+		return graph.edgeClass(e) == Graph::DEMAND_EDGE ? f(demand) : f(RoadKernel(travelTime.data()));
+	}
+
+	// Calls visit(begin, end, kernel) for the part [begin, end) of [first, last) covered by the road
+	// edges and by the demand edges, where kernel evaluates their travel cost function without branches.
+	template <typename VisitorT>
+	void forEachEdgeClass(const int first, const int last, VisitorT visit) const {
+		const int roadEnd = graph.edgeClassEnd(Graph::ROAD_EDGE);
+		if (first < std::min(roadEnd, last))
+			visit(first, std::min(roadEnd, last), RoadKernel(travelTime.data()));
+		if (std::max(roadEnd, first) < last)
+			visit(std::max(roadEnd, first), last, demand);
+	}
+
+	// Writes the travel time on edge e, given the flow x[e], to out[e] for each e in [first, last).
+	void evaluate(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost(e, x);
+		});
+	}
+
+	// Writes the derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void derivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.derivative(e, x);
+		});
+	}
+
+	// Writes the second derivative of e's travel cost function at x[e] to out[e] for each e in [first, last).
+	void secondDerivatives(const int first, const int last, const EdgeValue* x, double* out) const {
+		evaluateEdgeRangeByClass(*this, first, last, x, out, [](const auto& cost, const int e, const auto& x) {
+			return cost.secondDerivative(e, x);
+		});
 	}
 
-  // Returns the travel time on edge e, given the flow x on e.
-  double operator()(const int e, const double x) const {
-	  double x_new;
-	  const double cap = graph.capacity(e);
-	  
-	  if (graph.edgeReal(e))
-		  return bpr(e, exo*cap);
-	  else
-	  {
-		  x_new = x;
-		  const double pt = APT * cap;
-		  if (x_new <= pt)
-			  return bpr(e, x_new);
-		  else
-			  return bpr(e, pt) + bpr.derivative(e, pt) * (x_new - pt);
-	  }
-  }
-
-  // Returns the derivative of e's travel cost function at x.
-  double derivative(const int e, const double x) const {
-	  double x_new;
-	  const double cap = graph.capacity(e);
-	  if (graph.edgeReal(e))
-		  return 0.0;
-	  else
-	  {
-		  x_new = x;
-		  const double pt = APT * cap; // The point at which we linearize.
-		  if (x_new <= pt)
-			  return bpr.derivative(e, x_new);
-		  else
-			  return bpr.derivative(e, pt);
-	  }	  
-  }
-
-  // Returns the integral of e's travel cost function from 0 to b.
-  double integral(const int e, const double b) const {
-	  // this is not supposed to happen
-	  std::cout << "INTEGRAL OF APPROXBPR IS USED " << b << e << std::endl;	  
-	  return 0.0;
-  }
-
-  // Returns the travel times on four consecutive edges starting at e, given the flows x on them.
-  Vec4d operator()(const int e, const Vec4d& x) const {
-	  const double cap = graph.capacity(e);
-	  const Vec4d cap_v(cap);
-	  Vec4d edgeReal, edgeFake;
-	  edgeReal.load(&graph.edgeReal(e));
-	  edgeFake.load(&graph.edgeFake(e));
-	  Vec4d val_fake = cbpr(e,x)*edgeFake;
-
-	  Vec4d x_new;
-	  Vec4d val_real = bpr(e, exo_v*cap_v) * edgeReal;
-	  
-	  return val_fake + val_real;
-  }
-
-  // Returns the derivative of e's travel cost function at x.
-  Vec4d derivative(const int e, const Vec4d& x) const{
-	  const double cap = graph.capacity(e);
-	  const Vec4d cap_v(cap);
-	  Vec4d edgeReal, edgeFake;
-	  edgeReal.load(&graph.edgeReal(e));
-	  edgeFake.load(&graph.edgeFake(e));
-	  Vec4d val_fake = cbpr.derivative(e,x)*edgeFake;
-
-	  // val_real is simply (0,0,0,0), and the correct values are already found in val_fake
-	  return val_fake;
-  }
-
-  private:
-	const GraphT& graph; // The graph on whose edges we operate.
-	BprFunction<GraphT> bpr; // The original BPR function.
-	CustomBprFunction<GraphT> cbpr; // The original BPR function.
-	double exo;
-	int dummy_id;
-	Vec4d exo_v;
+private:
+	const Graph& graph;               // The graph on whose edges we operate.
+	BprFunction::DemandKernel demand; // The travel cost function of the demand edges.
+	AlignedVector<double> travelTime; // The travel time for the exogenous flow on each road edge.
 };
@@ -2,24 +2,159 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <ostream>
 #include <iostream>
 #include <cstdio>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
-#include <csv.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Algorithms/GraphTraversal/DfsNumbering.h"
+#include "DataStructures/Utilities/Permutation.h"
+#include "Tools/Constants.h"
+#include "Tools/ParallelCsvReader.h"
+#include "Tools/Simd/AlignedVector.h"
 
 class Graph
 {
 public:
-	// Constructs a graph from csv edge file
-	Graph(const std::string& filename, const double ceParameter, const double constParameter) : vertexNum(0), ceParameter(ceParameter), constParameter(constParameter) {
+	// A contiguous range of edge IDs, as returned by outgoingEdges and incomingEdges.
+	class EdgeRange
+	{
+	public:
+		EdgeRange(const int* first, const int* last) : first(first), last(last) {}
+
+		const int* begin() const { return first; }
+		const int* end() const { return last; }
+		int size() const { return last - first; }
+
+	private:
+		const int* first;
+		const int* last;
+	};
+
+	// The per-edge coefficients precomputed for the travel cost functions. Each is stored as a
+	// separate aligned row of the coefficient block.
+	enum EdgeCoefficient
+	{
+		FREE_FLOW_TIME,    // t0, the travel time at free flow
+		CAPACITY,          // the capacity as a double
+		INVERSE_CAPACITY,  // 1/cap (zero for demand edges)
+		BPR_SLOPE,         // alpha * t0 / cap^beta (zero for demand edges)
+		BPR_EXPONENT,      // the BPR exponent beta (zero for demand edges)
+		DEMAND_SLOPE,      // the slope of the inverse demand function (zero for road edges)
+		DEMAND_INTERCEPT,  // the intercept of the inverse demand function (zero for road edges)
+		EXOGENOUS_FLOW,    // the background flow not subject to assignment (zero for demand edges)
+		NUM_EDGE_COEFFICIENTS
+	};
+
+	// The classes of edges, which differ in their travel cost functions. The edges are grouped by
+	// class at load time, so that the edges of each class form a contiguous range of IDs. Road edges
+	// have positive capacity and follow the BPR function, with the common exponents in classes of
+	// their own.
+	enum EdgeClass
+	{
+		ROAD_EDGE_BETA4, // a road edge whose BPR exponent is 4
+		ROAD_EDGE_BETA5, // a road edge whose BPR exponent is 5
+		ROAD_EDGE_BETA6, // a road edge whose BPR exponent is 6
+		ROAD_EDGE,       // a road edge with any other BPR exponent
+		DEMAND_EDGE,     // an edge with zero capacity, representing the inverse demand function
+		NUM_EDGE_CLASSES
+	};
+
+	// The orders in which the vertices can be renumbered at load time to improve locality. There is
+	// no partition order (by RecursiveBisection), since its inertial flow cuts need the coordinates
+	// of the vertices, which the edge file does not provide.
+	enum VertexOrder
+	{
+		ORIGINAL_ORDER, // keep the IDs from the input file
+		DFS_ORDER,      // number the vertices in the order a DFS reaches them
+		BFS_ORDER       // number the vertices in the order a BFS reaches them
+	};
+
+	// Constructs a graph from csv edge file or from a binary snapshot (detected by its magic bytes)
+	Graph(const std::string& filename, const double ceParameter, const double constParameter, const int numLandmarks = 16, const int treeMemoryLimit = 1024, const VertexOrder vertexOrder = ORIGINAL_ORDER) : vertexNum(0), ceParameter(ceParameter), constParameter(constParameter), landmarkCount(numLandmarks), treeMemory(treeMemoryLimit) {
 		vertexNum = 0;
-		readFrom(filename);
+		if (isSnapshot(filename))
+			readSnapshotFrom(filename);
+		else
+			readFrom(filename);
+		buildIncidenceLists();
+		if (vertexOrder != ORIGINAL_ORDER)
+			reorder(vertexOrder);
+		groupEdgesByClass();
+		buildCoefficients();
+	}
+
+	// Returns true if the specified file is a binary graph snapshot.
+	static bool isSnapshot(const std::string& filename) {
+		std::ifstream in(filename, std::ios::binary);
+		char magic[SNAPSHOT_MAGIC_SIZE] = {};
+		in.read(magic, sizeof(magic));
+		return in.good() && std::memcmp(magic, snapshotMagic(), sizeof(magic)) == 0;
+	}
+
+	// Writes the graph to a binary snapshot. The file consists of a header followed by the edge
+	// columns, each starting at an offset that is a multiple of the SIMD alignment. The edges are
+	// written in input order and with the vertex IDs of the input.
+	void writeSnapshotTo(const std::string& filename) const {
+		std::vector<int> tails(numEdges()), heads(numEdges());
+		std::vector<int> lengths(numEdges()), capacities(numEdges()), speeds(numEdges());
+		std::vector<double> freeTravelTimes(numEdges()), alphas(numEdges()), betas(numEdges()), exogenousFlows(numEdges());
+		for (int i = 0; i < numEdges(); ++i)
+		{
+			const int e = edgeId(i);
+			tails[i] = originalVertexId(edgeTail[e]);
+			heads[i] = originalVertexId(edgeHead[e]);
+			lengths[i] = edgeLength[e];
+			capacities[i] = edgeCapacity[e];
+			speeds[i] = edgeSpeed[e];
+			freeTravelTimes[i] = edgeFreeTravelTime[e];
+			alphas[i] = edgeBprAlpha[e];
+			betas[i] = edgeBprBeta[e];
+			exogenousFlows[i] = edgeExogenousFlow[e];
+		}
+
+		SnapshotHeader header = {};
+		std::memcpy(header.magic, snapshotMagic(), sizeof(header.magic));
+		header.version = SNAPSHOT_VERSION;
+		header.headerSize = sizeof(SnapshotHeader);
+		header.numVertices = vertexNum;
+		header.numEdges = numEdges();
+		const void* columns[NUM_SNAPSHOT_COLUMNS] = {
+			tails.data(), heads.data(), lengths.data(), capacities.data(), speeds.data(), freeTravelTimes.data(),
+			alphas.data(), betas.data(), exogenousFlows.data()
+		};
+		uint64_t offset = sizeof(SnapshotHeader);
+		for (int i = 0; i < NUM_SNAPSHOT_COLUMNS; ++i)
+		{
+			offset = alignSnapshotOffset(offset);
+			header.columnOffset[i] = offset;
+			offset += numEdges() * snapshotColumnSize(i);
+		}
+
+		std::ofstream out(filename, std::ios::binary);
+		if (!out.good())
+			throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (int i = 0; i < NUM_SNAPSHOT_COLUMNS; ++i)
+		{
+			const std::vector<char> padding(header.columnOffset[i] - out.tellp(), 0);
+			out.write(padding.data(), padding.size());
+			out.write(static_cast<const char*>(columns[i]), numEdges() * snapshotColumnSize(i));
+		}
+		if (!out.good())
+			throw std::invalid_argument("file cannot be written -- '" + filename + "'");
 	}
 							  
 	// Returns the number of vertices in the graph
@@ -67,6 +202,20 @@ public:
 		return edgeSpeed[e];
 	}
 
+	// Returns the edges leaving vertex u.
+	EdgeRange outgoingEdges(const int u) const {
+		assert(u >= 0);
+		assert(u < vertexNum);
+		return EdgeRange(&outEdges[0] + firstOutEdge[u], &outEdges[0] + firstOutEdge[u + 1]);
+	}
+
+	// Returns the edges entering vertex v.
+	EdgeRange incomingEdges(const int v) const {
+		assert(v >= 0);
+		assert(v < vertexNum);
+		return EdgeRange(&inEdges[0] + firstInEdge[v], &inEdges[0] + firstInEdge[v + 1]);
+	}
+
 	double weight(const int e) const 
 	{
 		assert(e >= 0);
@@ -81,6 +230,26 @@ public:
 		return edgeFreeTravelTime[e];
 	}
 
+	// Returns the exogenous (background) flow on edge e, which is not subject to assignment.
+	double exogenousFlow(const int e) const {
+		assert(e >= 0);
+		assert(e < edgeExogenousFlow.size());
+		return edgeExogenousFlow[e];
+	}
+
+	// Returns the specified precomputed coefficient of edge e.
+	double coefficient(const EdgeCoefficient c, const int e) const {
+		assert(e >= 0);
+		assert(e < numEdges());
+		return edgeCoefficients[c * coefficientStride + e];
+	}
+
+	// Returns the row of the specified coefficient, which is aligned for SIMD loads and padded to a
+	// multiple of the cache line size.
+	const double* coefficients(const EdgeCoefficient c) const {
+		return edgeCoefficients.data() + c * coefficientStride;
+	}
+
 	// Sets edge weight, which will be used in the AoN routine
 	void setWeight(const int e, const double v)
 	{
@@ -89,70 +258,469 @@ public:
 		edgeWeight[e] = v;
 	}
 
-	std::vector<double>& getWeights()
+	std::vector<EdgeValue>& getWeights()
 	{
 		return edgeWeight;
 	}
 
-	double combinedEquilibriumParameter()
+	double combinedEquilibriumParameter() const
 	{
 		return ceParameter;
 	}
 
-	double noramlDistanceMultiplier()
+	double noramlDistanceMultiplier() const
 	{
 		return constParameter;
 	}
+
+	// Returns the ID of vertex v in the input file.
+	int originalVertexId(const int v) const {
+		assert(v >= 0);
+		assert(v < vertexNum);
+		return originalVertex.size() == 0 ? v : originalVertex[v];
+	}
+
+	// Returns the ID of the vertex whose ID in the input file is v.
+	int vertexId(const int v) const {
+		assert(v >= 0);
+		assert(v < vertexNum);
+		return vertexPermutation.size() == 0 ? v : vertexPermutation[v];
+	}
+
+	// Returns the ID of edge e in the input file.
+	int originalEdgeId(const int e) const {
+		assert(e >= 0);
+		assert(e < numEdges());
+		return originalEdge.size() == 0 ? e : originalEdge[e];
+	}
+
+	// Returns the ID of the edge whose ID in the input file is e.
+	int edgeId(const int e) const {
+		assert(e >= 0);
+		assert(e < numEdges());
+		return edgePermutation.size() == 0 ? e : edgePermutation[e];
+	}
+
+	// Returns the first ID of the edges in the specified class.
+	int edgeClassBegin(const EdgeClass c) const {
+		return firstEdgeOfClass[c];
+	}
+
+	// Returns the past-the-end ID of the edges in the specified class.
+	int edgeClassEnd(const EdgeClass c) const {
+		return firstEdgeOfClass[c + 1];
+	}
+
+	// Returns the class of edge e.
+	EdgeClass edgeClass(const int e) const {
+		assert(e >= 0);
+		assert(e < numEdges());
+		int c = 0;
+		while (e >= firstEdgeOfClass[c + 1])
+			++c;
+		return static_cast<EdgeClass>(c);
+	}
+
+	// Returns the number of landmarks used by goal-directed searches.
+	int numLandmarks() const
+	{
+		return landmarkCount;
+	}
+
+	// Returns the memory (in MiB) available for storing shortest-path trees between iterations.
+	int treeMemoryLimit() const
+	{
+		return treeMemory;
+	}
 	
 private:
-	template <int numFields>
-	using CsvDialect = io::CSVReader<numFields>;
-	
-	void readFrom(const std::string& filename) {		
-		CsvDialect<5> edgeFile(filename);            // The CSV file containing the edge records.
-		edgeFile.read_header(io::ignore_extra_column, "edge_tail", "edge_head", "length", "capacity", "speed");
+	// Reads the graph from a CSV file, parsing chunks of the file in parallel.
+	void readFrom(const std::string& filename) {
+		ParallelCsvReader edgeFile(filename); // The CSV file containing the edge records.
+		const int tailCol = edgeFile.requiredColumnIndex("edge_tail");
+		const int headCol = edgeFile.requiredColumnIndex("edge_head");
+		const int lengthCol = edgeFile.requiredColumnIndex("length");
+		const int capacityCol = edgeFile.requiredColumnIndex("capacity");
+		const int speedCol = edgeFile.requiredColumnIndex("speed");
+		const int alphaCol = edgeFile.columnIndex("alpha");
+		const int betaCol = edgeFile.columnIndex("beta");
+		const int exogenousFlowCol = edgeFile.columnIndex("exo_flow");
 
-		int tail, head, length, capacity, speed;
-		
-		while(edgeFile.read_row(tail, head, length, capacity, speed))
-		{
-			edgeTail.push_back(tail);
-			edgeHead.push_back(head);
-			edgeCapacity.push_back(capacity);
-			edgeLength.push_back(length);
-			edgeSpeed.push_back(speed);
-
-			assert(tail >= 0);
-			assert(head >= 0);
-			assert(capacity >= 0);
-			assert(length >= 0);
-			assert(speed >= 0);
-
-			// update vertex number
-			if (tail + 1 > vertexNum || head + 1 > vertexNum)
-				vertexNum = std::max(tail, head) + 1;
+		const int m = edgeFile.numRows();
+		edgeTail.resize(m);
+		edgeHead.resize(m);
+		edgeCapacity.resize(m);
+		edgeLength.resize(m);
+		edgeSpeed.resize(m);
+		edgeFreeTravelTime.resize(m);
+		edgeBprAlpha.resize(m);
+		edgeBprBeta.resize(m);
+		edgeExogenousFlow.resize(m);
+		edgeFile.forEachRow([&](const int e, const ParallelCsvReader::Row& row) {
+			edgeTail[e] = row.getInt(tailCol);
+			edgeHead[e] = row.getInt(headCol);
+			edgeLength[e] = row.getInt(lengthCol);
+			edgeCapacity[e] = row.getInt(capacityCol);
+			edgeSpeed[e] = row.getInt(speedCol);
+			if (edgeTail[e] < 0 || edgeHead[e] < 0)
+				throw std::invalid_argument("negative vertex ID");
+			edgeBprAlpha[e] = alphaCol != -1 ? row.getDouble(alphaCol) : 0.15;
+			edgeBprBeta[e] = betaCol != -1 ? row.getDouble(betaCol) : 4;
+			edgeExogenousFlow[e] = exogenousFlowCol != -1 ? row.getDouble(exogenousFlowCol) : 0;
+			if (edgeLength[e] < 0 || edgeCapacity[e] < 0 || edgeSpeed[e] < 0)
+				throw std::invalid_argument("negative length, capacity or speed");
+			if (edgeCapacity[e] > 0 && !(edgeBprAlpha[e] >= 0 && edgeBprBeta[e] >= 1))
+				throw std::invalid_argument("BPR alpha must be nonnegative and beta at least 1");
+			if (!(edgeExogenousFlow[e] >= 0))
+				throw std::invalid_argument("negative exogenous flow");
 
 			// compute free flow travel time in minutes
-			double freeFlowTravelTime = 60 * 60 * ((double) length / 1000.0) / ((double) speed);
-			edgeFreeTravelTime.push_back(freeFlowTravelTime);
-			edgeWeight.push_back(freeFlowTravelTime); // initial edge weight
+			edgeFreeTravelTime[e] = 60 * 60 * ((double) edgeLength[e] / 1000.0) / ((double) edgeSpeed[e]);
+		});
+
+		// update vertex number
+		for (int e = 0; e < m; ++e)
+			vertexNum = std::max(vertexNum, std::max(edgeTail[e], edgeHead[e]) + 1);
+		edgeWeight.assign(edgeFreeTravelTime.begin(), edgeFreeTravelTime.end()); // initial edge weights
+	}
+
+	// The magic bytes and the version of the binary snapshot format.
+	static const char* snapshotMagic() { return "FWGRAPH"; }
+	static constexpr int SNAPSHOT_MAGIC_SIZE = 8;
+	static constexpr uint32_t SNAPSHOT_VERSION = 3;
+	static constexpr int NUM_SNAPSHOT_COLUMNS = 9; // tail, head, length, capacity, speed, t0, alpha, beta, exo flow
+	static constexpr int NUM_INT_SNAPSHOT_COLUMNS = 5;
+	static constexpr uint64_t SNAPSHOT_ALIGNMENT = 64;
+
+	// The header at the start of a binary snapshot.
+	struct SnapshotHeader
+	{
+		char magic[SNAPSHOT_MAGIC_SIZE];
+		uint32_t version;
+		uint32_t headerSize;
+		int64_t numVertices;
+		int64_t numEdges;
+		uint64_t columnOffset[NUM_SNAPSHOT_COLUMNS]; // byte offset of each column in the file
+	};
+
+	// Returns the size in bytes of a single entry in the i-th snapshot column.
+	static uint64_t snapshotColumnSize(const int i) {
+		return i < NUM_INT_SNAPSHOT_COLUMNS ? sizeof(int) : sizeof(double);
+	}
+
+	// Returns the smallest aligned offset not less than the specified one.
+	static uint64_t alignSnapshotOffset(const uint64_t offset) {
+		return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+	}
+
+	// Reads the graph from a binary snapshot. Since the columns in the file are aligned, each is read
+	// directly into the (aligned) storage of the corresponding edge attribute, without parsing and
+	// without an intermediate copy.
+	void readSnapshotFrom(const std::string& filename) {
+		const int fd = open(filename.c_str(), O_RDONLY);
+		struct stat fileStatus;
+		if (fd == -1 || fstat(fd, &fileStatus) == -1)
+		{
+			if (fd != -1)
+				close(fd);
+			throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+		}
+		const uint64_t fileSize = fileStatus.st_size;
+
+		SnapshotHeader header;
+		bool valid = readFully(fd, &header, sizeof(header), 0);
+		if (valid)
+		{
+			valid = header.version == SNAPSHOT_VERSION && header.headerSize == sizeof(SnapshotHeader) &&
+				header.numVertices >= 0 && header.numEdges >= 0 && header.numEdges < INT32_MAX;
+			for (int i = 0; valid && i < NUM_SNAPSHOT_COLUMNS; ++i)
+				valid = header.columnOffset[i] % SNAPSHOT_ALIGNMENT == 0 &&
+					header.columnOffset[i] + header.numEdges * snapshotColumnSize(i) <= fileSize;
 		}
+		if (!valid)
+		{
+			close(fd);
+			throw std::invalid_argument("invalid or incompatible graph snapshot -- '" + filename + "'");
+		}
+
+		const int m = header.numEdges;
+		vertexNum = header.numVertices;
+		edgeTail.resize(m);
+		edgeHead.resize(m);
+		edgeLength.resize(m);
+		edgeCapacity.resize(m);
+		edgeSpeed.resize(m);
+		edgeFreeTravelTime.resize(m);
+		edgeBprAlpha.resize(m);
+		edgeBprBeta.resize(m);
+		edgeExogenousFlow.resize(m);
+		void* const columns[NUM_SNAPSHOT_COLUMNS] = {
+			edgeTail.data(), edgeHead.data(), edgeLength.data(), edgeCapacity.data(),
+			edgeSpeed.data(), edgeFreeTravelTime.data(), edgeBprAlpha.data(), edgeBprBeta.data(),
+			edgeExogenousFlow.data()
+		};
+		for (int i = 0; valid && i < NUM_SNAPSHOT_COLUMNS; ++i)
+			valid = readFully(fd, columns[i], m * snapshotColumnSize(i), header.columnOffset[i]);
+		close(fd);
+		if (!valid)
+			throw std::invalid_argument("file cannot be read -- '" + filename + "'");
+
+		edgeWeight.assign(edgeFreeTravelTime.begin(), edgeFreeTravelTime.end()); // initial edge weights
+		for (int e = 0; e < m; ++e)
+			if (edgeTail[e] < 0 || edgeTail[e] >= vertexNum || edgeHead[e] < 0 || edgeHead[e] >= vertexNum)
+				throw std::invalid_argument("invalid vertex ID in graph snapshot -- '" + filename + "'");
 	}
-	
+
+	// Reads size bytes at the specified offset of the file into buffer. Returns false on failure.
+	static bool readFully(const int fd, void* const buffer, const uint64_t size, const uint64_t offset) {
+		char* const bytes = static_cast<char*>(buffer);
+		uint64_t numBytesRead = 0;
+		while (numBytesRead < size)
+		{
+			const ssize_t n = pread(fd, bytes + numBytesRead, size - numBytesRead, offset + numBytesRead);
+			if (n <= 0)
+				return false;
+			numBytesRead += n;
+		}
+		return true;
+	}
+
+	// Renumbers the vertices in the specified order and sorts the edges by tail (and head). The
+	// traversal ignores edge directions and starts a new tree at each vertex not yet reached, in
+	// the order of the input IDs.
+	void reorder(const VertexOrder vertexOrder) {
+		if (vertexOrder == DFS_ORDER)
+		{
+			const std::vector<int> dfsNumbers = DfsNumbering().run(UndirectedView(*this));
+			vertexPermutation = Permutation(dfsNumbers.begin(), dfsNumbers.end());
+			originalVertex = vertexPermutation.getInversePermutation();
+		}
+		else
+		{
+			std::vector<int> order; // the vertices in the order a BFS reaches them
+			std::vector<bool> reached(vertexNum, false);
+			for (int root = 0; root < vertexNum; ++root)
+			{
+				if (reached[root])
+					continue;
+				reached[root] = true;
+				order.push_back(root);
+				for (int i = order.size() - 1; i < order.size(); ++i)
+					for (int j = 0; j < numNeighbors(order[i]); ++j)
+					{
+						const int v = neighbor(order[i], j);
+						if (!reached[v])
+						{
+							reached[v] = true;
+							order.push_back(v);
+						}
+					}
+			}
+			originalVertex.assign(order.begin(), order.end());
+			vertexPermutation = originalVertex.getInversePermutation();
+		}
+		for (int e = 0; e < numEdges(); ++e)
+		{
+			edgeTail[e] = vertexPermutation[edgeTail[e]];
+			edgeHead[e] = vertexPermutation[edgeHead[e]];
+		}
+
+		std::vector<int> edges(numEdges());
+		for (int e = 0; e < numEdges(); ++e)
+			edges[e] = e;
+		std::stable_sort(edges.begin(), edges.end(), [&](const int e1, const int e2) {
+			return std::make_pair(edgeTail[e1], edgeHead[e1]) < std::make_pair(edgeTail[e2], edgeHead[e2]);
+		});
+		permuteEdges(edges);
+	}
+
+	// Returns the class that edge e falls into, judging by its attributes.
+	EdgeClass classifyEdge(const int e) const {
+		if (edgeCapacity[e] == 0)
+			return DEMAND_EDGE;
+		if (edgeBprBeta[e] == 4)
+			return ROAD_EDGE_BETA4;
+		if (edgeBprBeta[e] == 5)
+			return ROAD_EDGE_BETA5;
+		if (edgeBprBeta[e] == 6)
+			return ROAD_EDGE_BETA6;
+		return ROAD_EDGE;
+	}
+
+	// Sorts the edges by class, keeping the relative order within each class.
+	void groupEdgesByClass() {
+		std::vector<int> edges(numEdges());
+		std::vector<EdgeClass> classOf(numEdges());
+		for (int e = 0; e < numEdges(); ++e)
+		{
+			edges[e] = e;
+			classOf[e] = classifyEdge(e);
+		}
+		std::stable_sort(edges.begin(), edges.end(), [&](const int e1, const int e2) {
+			return classOf[e1] < classOf[e2];
+		});
+
+		std::fill(firstEdgeOfClass, firstEdgeOfClass + NUM_EDGE_CLASSES + 1, 0);
+		for (int e = 0; e < numEdges(); ++e)
+			++firstEdgeOfClass[classOf[e] + 1];
+		for (int c = 0; c < NUM_EDGE_CLASSES; ++c)
+			firstEdgeOfClass[c + 1] += firstEdgeOfClass[c];
+		if (!std::is_sorted(edges.begin(), edges.end()))
+			permuteEdges(edges);
+	}
+
+	// Renumbers the edges such that the k-th edge is the one that currently has ID edges[k].
+	void permuteEdges(const std::vector<int>& edges) {
+		std::vector<int> inputIds(numEdges());
+		for (int k = 0; k < numEdges(); ++k)
+			inputIds[k] = originalEdgeId(edges[k]);
+		const Permutation permutation = Permutation(edges.begin(), edges.end()).getInversePermutation();
+		permutation.applyTo(edgeTail);
+		permutation.applyTo(edgeHead);
+		permutation.applyTo(edgeCapacity);
+		permutation.applyTo(edgeLength);
+		permutation.applyTo(edgeSpeed);
+		permutation.applyTo(edgeFreeTravelTime);
+		permutation.applyTo(edgeBprAlpha);
+		permutation.applyTo(edgeBprBeta);
+		permutation.applyTo(edgeExogenousFlow);
+		permutation.applyTo(edgeWeight);
+		originalEdge.assign(inputIds.begin(), inputIds.end());
+		edgePermutation = originalEdge.getInversePermutation();
+		buildIncidenceLists();
+	}
+
+	// The graph with edge directions ignored, in the interface of the graph traversal algorithms.
+	// The edges out of u in the view lead to the vertices adjacent to u, in the order of neighbor.
+	class UndirectedView
+	{
+	public:
+		explicit UndirectedView(const Graph& graph) : firstNeighbor(graph.numVertices() + 1, 0) {
+			for (int u = 0; u < graph.numVertices(); ++u)
+			{
+				firstNeighbor[u + 1] = firstNeighbor[u] + graph.numNeighbors(u);
+				for (int j = 0; j < graph.numNeighbors(u); ++j)
+					neighbors.push_back(graph.neighbor(u, j));
+			}
+		}
+
+		int numVertices() const { return firstNeighbor.size() - 1; }
+		int firstEdge(const int u) const { return firstNeighbor[u]; }
+		int lastEdge(const int u) const { return firstNeighbor[u + 1]; }
+		int edgeHead(const int e) const { return neighbors[e]; }
+
+		bool containsEdge(const int u, const int v) const {
+			return std::find(neighbors.begin() + firstEdge(u), neighbors.begin() + lastEdge(u), v) != neighbors.begin() + lastEdge(u);
+		}
+
+	private:
+		std::vector<int> firstNeighbor; // the index of the first neighbor of each vertex in neighbors
+		std::vector<int> neighbors;     // the neighbors of the vertices, grouped by vertex
+	};
+
+	// Returns the number of vertices adjacent to u, ignoring edge directions.
+	int numNeighbors(const int u) const {
+		return outgoingEdges(u).size() + incomingEdges(u).size();
+	}
+
+	// Returns the j-th vertex adjacent to u, ignoring edge directions.
+	int neighbor(const int u, const int j) const {
+		const EdgeRange out = outgoingEdges(u);
+		return j < out.size() ? edgeHead[out.begin()[j]] : edgeTail[incomingEdges(u).begin()[j - out.size()]];
+	}
+
+	// Precomputes the coefficients of the travel cost functions. A road edge costs t0 + c * x^beta
+	// under the BPR function, and an edge with zero capacity represents the inverse demand function
+	// length/2 * x + speed. Exogenous flow is kept for road edges only.
+	void buildCoefficients() {
+		const int doublesPerLine = CACHE_LINE_SIZE / sizeof(double);
+		coefficientStride = (numEdges() + doublesPerLine - 1) / doublesPerLine * doublesPerLine;
+		edgeCoefficients.assign(NUM_EDGE_COEFFICIENTS * coefficientStride, 0.0);
+		double* const row = edgeCoefficients.data();
+		for (int e = 0; e < numEdges(); ++e)
+		{
+			const double t0 = edgeFreeTravelTime[e];
+			const double cap = edgeCapacity[e];
+			row[FREE_FLOW_TIME * coefficientStride + e] = t0;
+			row[CAPACITY * coefficientStride + e] = cap;
+			if (edgeCapacity[e] == 0)
+			{
+				row[DEMAND_SLOPE * coefficientStride + e] = edgeLength[e] * 0.5;
+				row[DEMAND_INTERCEPT * coefficientStride + e] = edgeSpeed[e];
+			}
+			else
+			{
+				row[INVERSE_CAPACITY * coefficientStride + e] = 1 / cap;
+				row[BPR_SLOPE * coefficientStride + e] = edgeBprAlpha[e] * t0 / std::pow(cap, edgeBprBeta[e]);
+				row[BPR_EXPONENT * coefficientStride + e] = edgeBprBeta[e];
+				row[EXOGENOUS_FLOW * coefficientStride + e] = edgeExogenousFlow[e];
+			}
+		}
+	}
+
+	// Builds the lists of outgoing and incoming edges of each vertex (in compressed row format).
+	void buildIncidenceLists() {
+		firstOutEdge.assign(vertexNum + 1, 0);
+		firstInEdge.assign(vertexNum + 1, 0);
+		for (int e = 0; e < numEdges(); ++e)
+		{
+			++firstOutEdge[edgeTail[e] + 1];
+			++firstInEdge[edgeHead[e] + 1];
+		}
+
+		for (int u = 0; u < vertexNum; ++u)
+		{
+			firstOutEdge[u + 1] += firstOutEdge[u];
+			firstInEdge[u + 1] += firstInEdge[u];
+		}
+
+		// Fill both lists in order of edge IDs, using the first entries as insertion points.
+		outEdges.resize(numEdges());
+		inEdges.resize(numEdges());
+		std::vector<int> nextOut(firstOutEdge.begin(), firstOutEdge.end() - 1);
+		std::vector<int> nextIn(firstInEdge.begin(), firstInEdge.end() - 1);
+		for (int e = 0; e < numEdges(); ++e)
+		{
+			outEdges[nextOut[edgeTail[e]]++] = e;
+			inEdges[nextIn[edgeHead[e]]++] = e;
+		}
+	}
+
 	int vertexNum;
-	std::vector<int> edgeTail;
-	std::vector<int> edgeHead;
-	std::vector<int> edgeCapacity; // vehicles / h
-	std::vector<int> edgeLength; // length (m)
-	std::vector<int> edgeSpeed; // travel time in free flow (k/h)
-	std::vector<double> edgeFreeTravelTime; // hours
-	std::vector<double> edgeWeight; // current travel time, in hours
+	AlignedVector<int> edgeTail;
+	AlignedVector<int> edgeHead;
+	AlignedVector<int> edgeCapacity; // vehicles / h
+	AlignedVector<int> edgeLength; // length (m)
+	AlignedVector<int> edgeSpeed; // travel time in free flow (k/h)
+	AlignedVector<double> edgeFreeTravelTime; // hours
+	AlignedVector<double> edgeBprAlpha; // the BPR parameter alpha (0.15 if not given)
+	AlignedVector<double> edgeBprBeta; // the BPR exponent beta (4 if not given)
+	AlignedVector<double> edgeExogenousFlow; // background flow not subject to assignment (0 if not given)
+	std::vector<EdgeValue> edgeWeight; // current travel time, in hours
+
+	std::vector<int> firstOutEdge; // index of the first outgoing edge of each vertex in outEdges
+	std::vector<int> outEdges;     // IDs of the outgoing edges, grouped by tail
+	std::vector<int> firstInEdge;  // index of the first incoming edge of each vertex in inEdges
+	std::vector<int> inEdges;      // IDs of the incoming edges, grouped by head
+
+	Permutation vertexPermutation; // the new ID of each vertex in the input (empty if not reordered)
+	Permutation originalVertex;    // the input ID of each vertex (empty if not reordered)
+	Permutation edgePermutation;   // the new ID of each edge in the input (empty if not reordered)
+	Permutation originalEdge;      // the input ID of each edge (empty if not reordered)
+	int firstEdgeOfClass[NUM_EDGE_CLASSES + 1] = {}; // the ID of the first edge in each class
+
+	AlignedVector<double> edgeCoefficients; // the coefficient rows, one after another
+	int coefficientStride = 0;              // the distance between two consecutive rows
 
 	double ceParameter; // parameter for combined equilibrium calculation
 	double constParameter; // parameter for constrained search (normal distance multiplier) 
+	int landmarkCount; // number of landmarks for goal-directed search
+	int treeMemory; // memory cap (MiB) for shortest-path trees kept between iterations
 };
 
 // Iteration macros for conveniently looping through vertices or edges of a graph.
 #define FORALL_VERTICES(G, u) for (int u = 0; u < G.numVertices(); ++u)
 #define FORALL_EDGES(G, e) for (int e = 0; e < G.numEdges(); ++e)
+#define FORALL_OUTGOING_EDGES(G, u, e) for (const int e : G.outgoingEdges(u))
+#define FORALL_INCOMING_EDGES(G, v, e) for (const int e : G.incomingEdges(v))
 // #define FORALL_INCIDENT_EDGES(G, u, e) for (int e = G.firstEdge(u); e < G.lastEdge(u); ++e)
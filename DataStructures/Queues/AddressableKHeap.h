@@ -9,8 +9,8 @@
 // Implementation of an addressable k-heap. It maintains a set of elements, each with an associated
 // ID and key, under the standard priority queue operations. The elements are addressed by the IDs.
 // This class is implemented as a min-heap, but can be easily turned into a max-heap by multiplying
-// the keys by -1.
-template <int K>
+// the keys by -1. The keys are of type KeyT, which defaults to int.
+template <int K, typename KeyT = int>
 class AddressableKHeap {
   static_assert(K > 0, "parameter k must be strictly positive");
 
@@ -38,7 +38,7 @@ class AddressableKHeap {
   }
 
   // Returns the minimum key.
-  int minKey() const {
+  KeyT minKey() const {
     assert(!empty());
     return heap[0].key;
   }
@@ -58,20 +58,20 @@ class AddressableKHeap {
   }
 
   // Inserts an element with the specified ID and key into this heap.
-  void insert(const int id, const int key) {
+  void insert(const int id, const KeyT key) {
     assert(!contains(id));
     heap.emplace_back(id, key);
     siftUp(heap.size() - 1);
   }
 
   // Returns the ID and key of an element with minimum key.
-  void min(int& id, int& key) const {
+  void min(int& id, KeyT& key) const {
     id = minId();
     key = minKey();
   }
 
   // Extracts an element with minimum key from this heap.
-  void deleteMin(int& id, int& key) {
+  void deleteMin(int& id, KeyT& key) {
     assert(!empty());
     min(id, key);
     elementIdToHeapIndex[id] = INVALID_INDEX;
@@ -82,7 +82,7 @@ class AddressableKHeap {
   }
 
   // Decreases the key of the element with the specified ID to newKey.
-  void decreaseKey(const int id, const int newKey) {
+  void decreaseKey(const int id, const KeyT newKey) {
     assert(contains(id));
     const int idx = elementIdToHeapIndex[id];
     assert(newKey <= heap[idx].key);
@@ -94,10 +94,10 @@ class AddressableKHeap {
   // An element in this heap, with an associated ID and key.
   struct HeapElement {
     // Constructs a heap element with the specified ID and key.
-    HeapElement(const int id, const int key) : id(id), key(key) {}
+    HeapElement(const int id, const KeyT key) : id(id), key(key) {}
 
     int id;
-    int key;
+    KeyT key;
   };
 
   // Moves the heap element stored in index idx toward the root until the heap property holds.
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A columnar binary store for the edge flows and costs of selected Frank-Wolfe iterations. The file
+// starts with a header. Each snapshot then consists of a flow column and a cost column, with one
+// double per edge in the order of the input edge file. Each column starts at an offset that is a
+// multiple of 64 bytes. An index of the snapshots and a footer follow at the end. A reader can map
+// the file into memory and access the columns of a single iteration without touching the others.
+namespace flowstore {
+
+// The magic bytes and the version of the format.
+inline const char* magic() { return "FWFLOWS"; }
+constexpr int MAGIC_SIZE = 8;
+constexpr uint32_t VERSION = 1;
+constexpr int NUM_COLUMNS = 2; // flow, cost
+constexpr uint64_t ALIGNMENT = 64;
+
+// The header at the start of a flow store.
+struct Header {
+	char magic[MAGIC_SIZE];
+	uint32_t version;
+	uint32_t headerSize;
+	int64_t numEdges;
+	int64_t numColumns;
+};
+
+// An entry of the index, describing one snapshot.
+struct IndexEntry {
+	int64_t iteration;                  // The number of the Frank-Wolfe iteration.
+	uint64_t columnOffset[NUM_COLUMNS]; // The byte offset of each column.
+};
+
+// The footer at the end of a flow store.
+struct Footer {
+	uint64_t indexOffset;
+	uint64_t numSnapshots;
+	char magic[MAGIC_SIZE];
+};
+
+// Returns the smallest aligned offset not less than the specified one.
+inline uint64_t alignOffset(const uint64_t offset) {
+	return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+}
+
+// Writes snapshots of the edge flows and costs to a columnar flow store.
+class FlowStoreWriter {
+public:
+	// Constructs a writer that is not associated with a file.
+	FlowStoreWriter() = default;
+
+	// Writes the index and footer, if a file is open.
+	~FlowStoreWriter() {
+		close();
+	}
+
+	// Opens the specified file and writes the header. A snapshot is due every interval iterations.
+	void open(const std::string& filename, const int numEdges, const int interval) {
+		assert(numEdges >= 0); assert(interval > 0);
+		out.open(filename, std::ios::binary);
+		if (!out.good())
+			throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+		edges = numEdges;
+		snapshotInterval = interval;
+		index.clear();
+
+		flowstore::Header header = {};
+		std::memcpy(header.magic, flowstore::magic(), sizeof(header.magic));
+		header.version = flowstore::VERSION;
+		header.headerSize = sizeof(header);
+		header.numEdges = numEdges;
+		header.numColumns = flowstore::NUM_COLUMNS;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		offset = sizeof(header);
+	}
+
+	// Returns true if a file is open.
+	bool isOpen() const {
+		return out.is_open();
+	}
+
+	// Returns true if a snapshot of the specified iteration is due.
+	bool isDue(const int iteration) const {
+		return isOpen() && iteration % snapshotInterval == 0;
+	}
+
+	// Writes a snapshot of the specified iteration. Both columns are in input edge order.
+	void write(const int iteration, const std::vector<double>& flows, const std::vector<double>& costs) {
+		assert(isOpen());
+		assert(flows.size() == edges); assert(costs.size() == edges);
+		flowstore::IndexEntry entry = {};
+		entry.iteration = iteration;
+		const std::vector<double>* const columns[flowstore::NUM_COLUMNS] = {&flows, &costs};
+		for (int i = 0; i < flowstore::NUM_COLUMNS; ++i)
+		{
+			pad(flowstore::alignOffset(offset) - offset);
+			entry.columnOffset[i] = offset;
+			out.write(reinterpret_cast<const char*>(columns[i]->data()), edges * sizeof(double));
+			offset += edges * sizeof(double);
+		}
+		if (!out.good())
+			throw std::invalid_argument("flow store cannot be written");
+		index.push_back(entry);
+	}
+
+	// Writes the index and footer and closes the file.
+	void close() {
+		if (!isOpen())
+			return;
+		alignIndex();
+		flowstore::Footer footer = {};
+		footer.indexOffset = offset;
+		footer.numSnapshots = index.size();
+		std::memcpy(footer.magic, flowstore::magic(), sizeof(footer.magic));
+		out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(flowstore::IndexEntry));
+		out.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+		out.close();
+	}
+
+private:
+	// Aligns the index to eight bytes.
+	void alignIndex() {
+		pad((offset + 7) / 8 * 8 - offset);
+	}
+
+	// Writes the specified number of zero bytes.
+	void pad(const uint64_t numBytes) {
+		static const char zeros[flowstore::ALIGNMENT] = {};
+		out.write(zeros, numBytes);
+		offset += numBytes;
+	}
+
+	std::ofstream out;                        // The output file.
+	int64_t edges = 0;                        // The number of edges.
+	int snapshotInterval = 1;                 // The number of iterations between snapshots.
+	uint64_t offset = 0;                      // The current byte offset in the file.
+	std::vector<flowstore::IndexEntry> index; // The index of the snapshots written so far.
+};
+
+// Provides access to the snapshots of a flow store, which is mapped into memory.
+class FlowStoreReader {
+public:
+	// Maps the specified flow store into memory and validates its header and index.
+	explicit FlowStoreReader(const std::string& filename) {
+		const int fd = ::open(filename.c_str(), O_RDONLY);
+		struct stat fileStatus;
+		if (fd == -1 || fstat(fd, &fileStatus) == -1)
+		{
+			if (fd != -1)
+				::close(fd);
+			throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+		}
+		fileSize = fileStatus.st_size;
+		file = fileSize > 0 ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		::close(fd);
+		if (file == MAP_FAILED)
+			throw std::invalid_argument("invalid or incompatible flow store -- '" + filename + "'");
+
+		if (!isValid())
+		{
+			munmap(file, fileSize);
+			throw std::invalid_argument("invalid or incompatible flow store -- '" + filename + "'");
+		}
+	}
+
+	// Unmaps the file.
+	~FlowStoreReader() {
+		munmap(file, fileSize);
+	}
+
+	FlowStoreReader(const FlowStoreReader&) = delete;
+	FlowStoreReader& operator=(const FlowStoreReader&) = delete;
+
+	// Returns the number of edges.
+	int numEdges() const {
+		return header().numEdges;
+	}
+
+	// Returns the number of snapshots.
+	int numSnapshots() const {
+		return footer().numSnapshots;
+	}
+
+	// Returns the Frank-Wolfe iteration of the k-th snapshot.
+	int iteration(const int k) const {
+		assert(k >= 0); assert(k < numSnapshots());
+		return entry(k).iteration;
+	}
+
+	// Returns the index of the snapshot of the specified iteration, or -1 if there is none.
+	int findSnapshot(const int iteration) const {
+		for (int k = 0; k < numSnapshots(); ++k)
+			if (entry(k).iteration == iteration)
+				return k;
+		return -1;
+	}
+
+	// Returns the flow on each edge in the k-th snapshot.
+	const double* flows(const int k) const {
+		assert(k >= 0); assert(k < numSnapshots());
+		return column(entry(k).columnOffset[0]);
+	}
+
+	// Returns the cost of each edge in the k-th snapshot.
+	const double* costs(const int k) const {
+		assert(k >= 0); assert(k < numSnapshots());
+		return column(entry(k).columnOffset[1]);
+	}
+
+private:
+	// Returns the header of the mapped file.
+	const flowstore::Header& header() const {
+		return *static_cast<const flowstore::Header*>(file);
+	}
+
+	// Returns the footer of the mapped file.
+	const flowstore::Footer& footer() const {
+		return *reinterpret_cast<const flowstore::Footer*>(data() + fileSize - sizeof(flowstore::Footer));
+	}
+
+	// Returns the k-th entry of the index.
+	const flowstore::IndexEntry& entry(const int k) const {
+		return reinterpret_cast<const flowstore::IndexEntry*>(data() + footer().indexOffset)[k];
+	}
+
+	// Returns the column at the specified offset.
+	const double* column(const uint64_t offset) const {
+		return reinterpret_cast<const double*>(data() + offset);
+	}
+
+	// Returns the first byte of the mapped file.
+	const char* data() const {
+		return static_cast<const char*>(file);
+	}
+
+	// Returns true if the header, footer and index are consistent with the file size.
+	bool isValid() const {
+		if (fileSize < sizeof(flowstore::Header) + sizeof(flowstore::Footer))
+			return false;
+		const flowstore::Header& h = header();
+		const flowstore::Footer& f = footer();
+		if (std::memcmp(h.magic, flowstore::magic(), sizeof(h.magic)) != 0 ||
+			std::memcmp(f.magic, flowstore::magic(), sizeof(f.magic)) != 0 ||
+			h.version != flowstore::VERSION || h.headerSize != sizeof(flowstore::Header) ||
+			h.numEdges < 0 || h.numColumns != flowstore::NUM_COLUMNS || f.indexOffset % 8 != 0 ||
+			f.indexOffset + f.numSnapshots * sizeof(flowstore::IndexEntry) + sizeof(flowstore::Footer) != fileSize)
+			return false;
+		for (int k = 0; k < f.numSnapshots; ++k)
+			for (int i = 0; i < flowstore::NUM_COLUMNS; ++i)
+				if (entry(k).columnOffset[i] % flowstore::ALIGNMENT != 0 ||
+					entry(k).columnOffset[i] + h.numEdges * sizeof(double) > f.indexOffset)
+					return false;
+		return true;
+	}
+
+	void* file = MAP_FAILED; // The mapped file.
+	uint64_t fileSize = 0;   // The size of the file in bytes.
+};
@@ -11,7 +11,7 @@
 // An origin-destination (OD) pair, representing a travel demand or a query.
 struct OriginDestination {
 	// Constructs an OD-pair from o to d.
-	OriginDestination(const int o, const int d, const int v)
+	OriginDestination(const int o, const int d, const double v)
 		: origin(o), destination(d), volume(v) {}
 
 	// Compares this OD-pair with rhs lexicographically.
@@ -21,14 +21,14 @@ struct OriginDestination {
 
 	int origin;
 	int destination;
-	int volume;
+	double volume;
 };
 
 // An origin-destination (OD) pair that additionally stores an origin zone and a destination zone.
 // Zones or traffic cells represent for example residential or commercial areas.
 struct ClusteredOriginDestination : public OriginDestination {
 	// Constructs a clustered OD-pair from o to d.
-	ClusteredOriginDestination(const int o, const int d, const int r, const int e1, const int e2, const int v)
+	ClusteredOriginDestination(const int o, const int d, const int r, const int e1, const int e2, const double v)
 		: OriginDestination(o, d, v), rebalancer(r), edge1(e1), edge2(e2) {}
 
 	// Compares this clustered OD-pair with rhs lexicographically.
@@ -54,7 +54,8 @@ struct ClusteredOriginDestination : public OriginDestination {
 // Reads the specified file into a vector of OD-pairs.
 std::vector<OriginDestination> importODPairsFrom(const std::string& infile) {
 	std::vector<OriginDestination> pairs;
-	int origin, destination, volume;
+	int origin, destination;
+	double volume;
 	using TrimPolicy = io::trim_chars<>;
 	using QuotePolicy = io::no_quote_escape<','>;
 	using OverflowPolicy = io::throw_on_overflow;
@@ -73,7 +74,8 @@ std::vector<OriginDestination> importODPairsFrom(const std::string& infile) {
 // Reads the specified file into a vector of clustered OD-pairs.
 std::vector<ClusteredOriginDestination> importClusteredODPairsFrom(const std::string& infile) {
 	std::vector<ClusteredOriginDestination> pairs;
-	int origin, destination, volume, edge1 = INVALID_ID, edge2 = INVALID_ID, rebalancer = INVALID_ID;
+	int origin, destination, edge1 = INVALID_ID, edge2 = INVALID_ID, rebalancer = INVALID_ID;
+	double volume;
 	using TrimPolicy = io::trim_chars<>;
 	using QuotePolicy = io::no_quote_escape<','>;
 	using OverflowPolicy = io::throw_on_overflow;
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Tools/Constants.h"
+#include "Tools/ParallelCsvReader.h"
+
+// A column-oriented collection of OD-pairs. Each pair has an origin, a destination and a volume,
+// which may be fractional (e.g., for scaled or sampled demand).
+// In elastic mode, each pair additionally has a rebalancer and two virtual edges, which are stored
+// only if requested. The pairs can be read from a CSV file or from a compact binary file, which is
+// mapped into memory and copied column by column without parsing.
+class OriginDestinationPairs {
+public:
+	// Constructs an empty collection, with or without the elastic columns.
+	explicit OriginDestinationPairs(const bool elasticColumns = false) : elastic(elasticColumns) {}
+
+	// Reads OD-pairs from a CSV or binary file (detected by its magic bytes). The elastic columns
+	// are kept only if requested.
+	OriginDestinationPairs(const std::string& filename, const bool elasticColumns) : elastic(elasticColumns) {
+		if (isBinary(filename))
+			readBinaryFrom(filename);
+		else
+			readCsvFrom(filename);
+	}
+
+	// Returns true if the specified file is a binary OD file.
+	static bool isBinary(const std::string& filename) {
+		std::ifstream in(filename, std::ios::binary);
+		char magic[MAGIC_SIZE] = {};
+		in.read(magic, sizeof(magic));
+		return in.good() && std::memcmp(magic, binaryMagic(), sizeof(magic)) == 0;
+	}
+
+	// Returns the number of OD-pairs.
+	int size() const {
+		return origins.size();
+	}
+
+	// Returns true if the rebalancers and virtual edges are stored.
+	bool hasElasticColumns() const {
+		return elastic;
+	}
+
+	// Returns the origin of the i-th OD-pair.
+	int origin(const int i) const {
+		assert(i >= 0); assert(i < size());
+		return origins[i];
+	}
+
+	// Returns the destination of the i-th OD-pair.
+	int destination(const int i) const {
+		assert(i >= 0); assert(i < size());
+		return destinations[i];
+	}
+
+	// Returns the volume of the i-th OD-pair.
+	double volume(const int i) const {
+		assert(i >= 0); assert(i < size());
+		return volumes[i];
+	}
+
+	// Returns the rebalancer of the i-th OD-pair (elastic mode only).
+	int rebalancer(const int i) const {
+		assert(elastic); assert(i >= 0); assert(i < size());
+		return rebalancers[i];
+	}
+
+	// Returns the first virtual edge of the i-th OD-pair (elastic mode only).
+	int edge1(const int i) const {
+		assert(elastic); assert(i >= 0); assert(i < size());
+		return firstEdges[i];
+	}
+
+	// Returns the second virtual edge of the i-th OD-pair (elastic mode only).
+	int edge2(const int i) const {
+		assert(elastic); assert(i >= 0); assert(i < size());
+		return secondEdges[i];
+	}
+
+	// Appends an OD-pair. The last three arguments are ignored unless the elastic columns are kept.
+	void add(const int o, const int d, const double v,
+			 const int r = INVALID_ID, const int e1 = INVALID_ID, const int e2 = INVALID_ID) {
+		origins.push_back(o);
+		destinations.push_back(d);
+		volumes.push_back(v);
+		if (elastic)
+		{
+			rebalancers.push_back(r);
+			firstEdges.push_back(e1);
+			secondEdges.push_back(e2);
+		}
+	}
+
+	// Returns the number of rows in the input, which exceeds the number of OD-pairs if identical
+	// rows were aggregated.
+	int numRows() const {
+		return pairOfRows.empty() ? size() : pairOfRows.size();
+	}
+
+	// Returns the OD-pair into which the specified input row was aggregated.
+	int pairOfRow(const int row) const {
+		assert(row >= 0); assert(row < numRows());
+		return pairOfRows.empty() ? row : pairOfRows[row];
+	}
+
+	// Merges OD-pairs with identical origin and destination (and identical rebalancer and virtual
+	// edges in elastic mode) into a single pair, summing their volumes. The pairs end up sorted by
+	// origin, which also helps searches that reuse the tree of the last origin. The mapping from
+	// the input rows to the merged pairs is kept.
+	void aggregate() {
+		const int rows = size();
+		std::vector<int> order(rows);
+		for (int i = 0; i < rows; ++i)
+			order[i] = i;
+		const auto key = [&](const int i) {
+			return elastic ?
+				std::make_tuple(origins[i], destinations[i], rebalancers[i], firstEdges[i], secondEdges[i]) :
+				std::make_tuple(origins[i], destinations[i], 0, 0, 0);
+		};
+		std::stable_sort(order.begin(), order.end(), [&](const int i, const int j) { return key(i) < key(j); });
+
+		OriginDestinationPairs merged(elastic);
+		std::vector<int32_t> pairOfRow(rows);
+		for (int k = 0; k < rows; ++k)
+		{
+			const int i = order[k];
+			if (k == 0 || key(i) != key(order[k - 1]))
+				merged.add(origins[i], destinations[i], 0,
+						   elastic ? rebalancers[i] : INVALID_ID,
+						   elastic ? firstEdges[i] : INVALID_ID,
+						   elastic ? secondEdges[i] : INVALID_ID);
+			merged.volumes.back() += volumes[i];
+			pairOfRow[i] = merged.size() - 1;
+		}
+		for (auto& pair : pairOfRows)
+			pair = pairOfRow[pair];
+		if (pairOfRows.empty())
+			pairOfRows.swap(pairOfRow);
+
+		origins.swap(merged.origins);
+		destinations.swap(merged.destinations);
+		volumes.swap(merged.volumes);
+		rebalancers.swap(merged.rebalancers);
+		firstEdges.swap(merged.firstEdges);
+		secondEdges.swap(merged.secondEdges);
+	}
+
+	// Appends the OD-pairs of other, whose input rows follow the rows of this collection.
+	void append(const OriginDestinationPairs& other) {
+		assert(elastic == other.elastic);
+		const int firstPair = size();
+		if (pairOfRows.empty() && !other.pairOfRows.empty())
+			for (int row = 0; row < firstPair; ++row)
+				pairOfRows.push_back(row);
+		if (!pairOfRows.empty())
+			for (int row = 0; row < other.numRows(); ++row)
+				pairOfRows.push_back(firstPair + other.pairOfRow(row));
+
+		origins.insert(origins.end(), other.origins.begin(), other.origins.end());
+		destinations.insert(destinations.end(), other.destinations.begin(), other.destinations.end());
+		volumes.insert(volumes.end(), other.volumes.begin(), other.volumes.end());
+		rebalancers.insert(rebalancers.end(), other.rebalancers.begin(), other.rebalancers.end());
+		firstEdges.insert(firstEdges.end(), other.firstEdges.begin(), other.firstEdges.end());
+		secondEdges.insert(secondEdges.end(), other.secondEdges.begin(), other.secondEdges.end());
+	}
+
+	// Replaces each vertex ID v by vertexId(v) and each edge ID e by edgeId(e).
+	template <typename VertexMapT, typename EdgeMapT>
+	void relabel(VertexMapT vertexId, EdgeMapT edgeId) {
+		for (int i = 0; i < size(); ++i)
+		{
+			origins[i] = vertexId(origins[i]);
+			destinations[i] = vertexId(destinations[i]);
+			if (!elastic)
+				continue;
+			if (rebalancers[i] != INVALID_ID)
+				rebalancers[i] = vertexId(rebalancers[i]);
+			if (firstEdges[i] != INVALID_ID)
+				firstEdges[i] = edgeId(firstEdges[i]);
+			if (secondEdges[i] != INVALID_ID)
+				secondEdges[i] = edgeId(secondEdges[i]);
+		}
+	}
+
+	// Writes the OD-pairs to a binary file. The file consists of a header followed by the columns,
+	// each starting at an offset that is a multiple of the cache line size.
+	void writeBinaryTo(const std::string& filename) const {
+		Header header = {};
+		std::memcpy(header.magic, binaryMagic(), sizeof(header.magic));
+		header.version = VERSION;
+		header.headerSize = sizeof(Header);
+		header.numPairs = size();
+		header.numColumns = elastic ? NUM_COLUMNS : NUM_BASIC_COLUMNS;
+		uint64_t offset = sizeof(Header);
+		forEachColumn(*this, header.numColumns, [&](const int i, const auto& column) {
+			offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+			header.columnOffset[i] = offset;
+			offset += size() * sizeof(column[0]);
+		});
+
+		std::ofstream out(filename, std::ios::binary);
+		if (!out.good())
+			throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		forEachColumn(*this, header.numColumns, [&](const int i, const auto& column) {
+			const std::vector<char> padding(header.columnOffset[i] - out.tellp(), 0);
+			out.write(padding.data(), padding.size());
+			out.write(reinterpret_cast<const char*>(column.data()), size() * sizeof(column[0]));
+		});
+		if (!out.good())
+			throw std::invalid_argument("file cannot be written -- '" + filename + "'");
+	}
+
+private:
+	// The magic bytes and the version of the binary format.
+	static const char* binaryMagic() { return "FWODPRS"; }
+	static constexpr int MAGIC_SIZE = 8;
+	static constexpr uint32_t VERSION = 2;
+	static constexpr int NUM_BASIC_COLUMNS = 3; // origin, destination, volume
+	static constexpr int NUM_COLUMNS = 6;       // ... plus rebalancer, edge1, edge2
+	static constexpr uint64_t ALIGNMENT = 64;
+
+	// The header at the start of a binary OD file.
+	struct Header
+	{
+		char magic[MAGIC_SIZE];
+		uint32_t version;
+		uint32_t headerSize;
+		int64_t numPairs;
+		uint32_t numColumns;
+		uint32_t padding;
+		uint64_t columnOffset[NUM_COLUMNS]; // byte offset of each column in the file
+	};
+
+	// Calls f(i, column) for each of the first numColumns columns of the specified collection, where
+	// i is the index of the column in the binary format.
+	template <typename PairsT, typename FunctionT>
+	static void forEachColumn(PairsT& pairs, const int numColumns, FunctionT f) {
+		f(0, pairs.origins);
+		f(1, pairs.destinations);
+		f(2, pairs.volumes);
+		if (numColumns == NUM_COLUMNS)
+		{
+			f(3, pairs.rebalancers);
+			f(4, pairs.firstEdges);
+			f(5, pairs.secondEdges);
+		}
+	}
+
+	// Reads OD-pairs from a CSV file, parsing only the needed columns of chunks of the file in
+	// parallel. The volume column is required in classic mode. In elastic mode, a missing volume column
+	// means one passenger per pair, and the other missing columns are filled with INVALID_ID.
+	void readCsvFrom(const std::string& filename) {
+		ParallelCsvReader in(filename);
+		const int originCol = in.requiredColumnIndex("origin");
+		const int destinationCol = in.requiredColumnIndex("destination");
+		const int volumeCol = elastic ? in.columnIndex("volume") : in.requiredColumnIndex("volume");
+		const int rebalancerCol = in.columnIndex("rebalancer");
+		const int edge1Col = in.columnIndex("edge1");
+		const int edge2Col = in.columnIndex("edge2");
+
+		const int n = in.numRows();
+		origins.resize(n);
+		destinations.resize(n);
+		volumes.resize(n);
+		if (elastic)
+		{
+			rebalancers.resize(n);
+			firstEdges.resize(n);
+			secondEdges.resize(n);
+		}
+		in.forEachRow([&](const int i, const ParallelCsvReader::Row& row) {
+			origins[i] = row.getInt(originCol);
+			destinations[i] = row.getInt(destinationCol);
+			volumes[i] = volumeCol != -1 ? row.getDouble(volumeCol) : 1;
+			if (origins[i] < 0 || destinations[i] < 0)
+				throw std::invalid_argument("negative vertex ID");
+			if (!(volumes[i] >= 0))
+				throw std::invalid_argument("negative volume");
+			if (elastic)
+			{
+				rebalancers[i] = rebalancerCol != -1 ? row.getInt(rebalancerCol) : INVALID_ID;
+				firstEdges[i] = edge1Col != -1 ? row.getInt(edge1Col) : INVALID_ID;
+				secondEdges[i] = edge2Col != -1 ? row.getInt(edge2Col) : INVALID_ID;
+			}
+		});
+	}
+
+	// Reads OD-pairs from a binary file, mapping it into memory and copying the needed columns.
+	void readBinaryFrom(const std::string& filename) {
+		const int fd = open(filename.c_str(), O_RDONLY);
+		struct stat fileStatus;
+		if (fd == -1 || fstat(fd, &fileStatus) == -1)
+		{
+			if (fd != -1)
+				close(fd);
+			throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+		}
+		const uint64_t fileSize = fileStatus.st_size;
+		void* const file = fileSize > 0 ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (file == MAP_FAILED)
+			throw std::invalid_argument("file cannot be mapped -- '" + filename + "'");
+
+		const char* const data = static_cast<const char*>(file);
+		Header header;
+		bool valid = fileSize >= sizeof(Header);
+		if (valid)
+		{
+			std::memcpy(&header, data, sizeof(header));
+			valid = header.version == VERSION && header.headerSize == sizeof(Header) &&
+				(header.numColumns == NUM_BASIC_COLUMNS || header.numColumns == NUM_COLUMNS) &&
+				header.numPairs >= 0 && header.numPairs < INT32_MAX;
+			if (valid)
+				forEachColumn(*this, header.numColumns, [&](const int i, const auto& column) {
+					valid = valid && header.columnOffset[i] + header.numPairs * sizeof(column[0]) <= fileSize;
+				});
+		}
+		if (!valid || (elastic && header.numColumns != NUM_COLUMNS))
+		{
+			munmap(file, fileSize);
+			const std::string msg = valid ? "OD file lacks the elastic columns" : "invalid or incompatible OD file";
+			throw std::invalid_argument(msg + " -- '" + filename + "'");
+		}
+
+		forEachColumn(*this, elastic ? NUM_COLUMNS : NUM_BASIC_COLUMNS, [&](const int i, auto& column) {
+			column.resize(header.numPairs);
+			std::memcpy(column.data(), data + header.columnOffset[i], header.numPairs * sizeof(column[0]));
+		});
+		munmap(file, fileSize);
+	}
+
+	bool elastic;                      // Are the rebalancers and virtual edges stored?
+	std::vector<int32_t> origins;      // The origin of each OD-pair.
+	std::vector<int32_t> destinations; // The destination of each OD-pair.
+	std::vector<double> volumes;       // The volume of each OD-pair.
+	std::vector<int32_t> rebalancers;  // The rebalancer of each OD-pair (elastic mode only).
+	std::vector<int32_t> firstEdges;   // The first virtual edge of each OD-pair (elastic mode only).
+	std::vector<int32_t> secondEdges;  // The second virtual edge of each OD-pair (elastic mode only).
+	std::vector<int32_t> pairOfRows;   // The OD-pair of each input row (empty if not aggregated).
+};
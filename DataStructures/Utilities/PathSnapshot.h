@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+// An immutable copy of the paths of all OD-pairs, with the edges of all paths stored contiguously.
+// It is cheap to take and can be handed to another thread while the original paths change.
+class PathSnapshot {
+public:
+	// The edges on a single path.
+	class Path {
+	public:
+		Path(const int32_t* first, const int32_t* last) : first(first), last(last) {}
+
+		const int32_t* begin() const { return first; }
+		const int32_t* end() const { return last; }
+		int size() const { return last - first; }
+
+	private:
+		const int32_t* first; // The first edge.
+		const int32_t* last;  // The past-the-end edge.
+	};
+
+	// Constructs an empty snapshot.
+	PathSnapshot() = default;
+
+	// Copies the specified paths.
+	explicit PathSnapshot(const std::vector<std::list<int>>& paths) {
+		firstEdge.reserve(paths.size() + 1);
+		firstEdge.push_back(0);
+		for (const auto& path : paths)
+		{
+			edges.insert(edges.end(), path.begin(), path.end());
+			firstEdge.push_back(edges.size());
+		}
+	}
+
+	// Returns the number of paths.
+	int size() const {
+		return firstEdge.empty() ? 0 : firstEdge.size() - 1;
+	}
+
+	// Returns the i-th path.
+	Path operator[](const int i) const {
+		assert(i >= 0); assert(i < size());
+		return Path(edges.data() + firstEdge[i], edges.data() + firstEdge[i + 1]);
+	}
+
+private:
+	std::vector<int32_t> edges;     // The edges on all paths, path after path.
+	std::vector<int64_t> firstEdge; // The index of the first edge of each path, plus the total.
+};
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A compact binary store for the paths of the OD-pairs in each Frank-Wolfe iteration. The file
+// starts with a header and the mapping from input rows to OD-pairs. Then there is one record per
+// iteration. Each record lists paths as the gap to the previous OD-pair written, the number of
+// edges, and the differences between consecutive edge IDs. All of these are written as varints,
+// and the differences are zigzag-encoded. An index of the records and a footer follow at the end.
+// In changed-only mode, a record holds only the paths that differ from the last path written for
+// the same OD-pair. The path of a pair in iteration k is then the one in the last record at or
+// before k that contains the pair.
+namespace pathstore {
+
+// The magic bytes and the version of the format.
+inline const char* magic() { return "FWPATHS"; }
+constexpr int MAGIC_SIZE = 8;
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t CHANGED_ONLY = 1; // The flag indicating changed-only mode.
+
+// The header at the start of a path store.
+struct Header {
+	char magic[MAGIC_SIZE];
+	uint32_t version;
+	uint32_t flags;
+	int64_t numPairs;
+	int64_t numRows; // followed by the OD-pair of each input row (as int32)
+};
+
+// An entry of the index, describing one iteration record.
+struct IndexEntry {
+	int32_t iteration; // The number of the Frank-Wolfe iteration.
+	uint32_t numPaths; // The number of paths in the record.
+	uint64_t offset;   // The byte offset of the record.
+	uint64_t size;     // The size of the record in bytes.
+};
+
+// The footer at the end of a path store.
+struct Footer {
+	uint64_t indexOffset;
+	uint64_t numIterations;
+	char magic[MAGIC_SIZE];
+};
+
+// Appends the specified unsigned value as a varint to the buffer.
+inline void writeVarint(std::vector<uint8_t>& buffer, uint64_t value) {
+	while (value >= 0x80)
+	{
+		buffer.push_back(static_cast<uint8_t>(value) | 0x80);
+		value >>= 7;
+	}
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+// Reads a varint from the buffer, advancing pos.
+inline uint64_t readVarint(const std::vector<uint8_t>& buffer, size_t& pos) {
+	uint64_t value = 0;
+	for (int shift = 0; ; shift += 7)
+	{
+		if (pos >= buffer.size() || shift > 63)
+			throw std::invalid_argument("corrupt path store record");
+		const uint8_t byte = buffer[pos++];
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+}
+
+// Maps a signed value to an unsigned one, such that values of small magnitude stay small.
+inline uint64_t zigzag(const int64_t value) {
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+// Inverts zigzag.
+inline int64_t unzigzag(const uint64_t value) {
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}
+
+// Writes the paths of each iteration to a binary path store.
+class PathStoreWriter {
+public:
+	// Constructs a writer that is not associated with a file.
+	PathStoreWriter() = default;
+
+	// Writes the index and footer, if a file is open.
+	~PathStoreWriter() {
+		close();
+	}
+
+	// Opens the specified file and writes the header. The i-th input row of OD-pairs has been
+	// aggregated into the OD-pair pairOfRow(i).
+	template <typename PairOfRowT>
+	void open(const std::string& filename, const int numPairs, const int numRows, PairOfRowT pairOfRow,
+			  const bool changedOnly) {
+		out.open(filename, std::ios::binary);
+		if (!out.good())
+			throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+		onlyChanged = changedOnly;
+		lastPaths.assign(numPairs, std::vector<int32_t>());
+		hasLastPath.assign(numPairs, false);
+		index.clear();
+
+		pathstore::Header header = {};
+		std::memcpy(header.magic, pathstore::magic(), sizeof(header.magic));
+		header.version = pathstore::VERSION;
+		header.flags = changedOnly ? pathstore::CHANGED_ONLY : 0;
+		header.numPairs = numPairs;
+		header.numRows = numRows;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		std::vector<int32_t> pairs(numRows);
+		for (int i = 0; i < numRows; ++i)
+			pairs[i] = pairOfRow(i);
+		out.write(reinterpret_cast<const char*>(pairs.data()), pairs.size() * sizeof(int32_t));
+		offset = sizeof(header) + pairs.size() * sizeof(int32_t);
+	}
+
+	// Returns true if a file is open.
+	bool isOpen() const {
+		return out.is_open();
+	}
+
+	// Writes the paths of the specified iteration, translating each edge ID with originalEdgeId.
+	// Each element paths[i] must be a range of edge IDs.
+	template <typename PathsT, typename EdgeMapT>
+	void writeIteration(const int iteration, const PathsT& paths, EdgeMapT originalEdgeId) {
+		assert(isOpen());
+		assert(paths.size() == lastPaths.size());
+		record.clear();
+		int numPaths = 0;
+		int lastPair = -1;
+		for (int i = 0; i < paths.size(); ++i)
+		{
+			path.clear();
+			for (const int e : paths[i])
+				path.push_back(originalEdgeId(e));
+			if (onlyChanged && hasLastPath[i] && path == lastPaths[i])
+				continue;
+
+			pathstore::writeVarint(record, i - lastPair - 1);
+			pathstore::writeVarint(record, path.size());
+			int64_t lastEdge = 0;
+			for (const int32_t e : path)
+			{
+				pathstore::writeVarint(record, pathstore::zigzag(e - lastEdge));
+				lastEdge = e;
+			}
+			if (onlyChanged)
+			{
+				lastPaths[i].swap(path);
+				hasLastPath[i] = true;
+			}
+			lastPair = i;
+			++numPaths;
+		}
+
+		out.write(reinterpret_cast<const char*>(record.data()), record.size());
+		if (!out.good())
+			throw std::invalid_argument("path store cannot be written");
+		index.push_back({iteration, static_cast<uint32_t>(numPaths), offset, record.size()});
+		offset += record.size();
+	}
+
+	// Writes the index and footer and closes the file.
+	void close() {
+		if (!isOpen())
+			return;
+		pathstore::Footer footer = {};
+		footer.indexOffset = offset;
+		footer.numIterations = index.size();
+		std::memcpy(footer.magic, pathstore::magic(), sizeof(footer.magic));
+		out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(pathstore::IndexEntry));
+		out.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+		out.close();
+	}
+
+private:
+	std::ofstream out;                           // The output file.
+	bool onlyChanged = false;                    // Are only the changed paths written?
+	uint64_t offset = 0;                         // The current byte offset in the file.
+	std::vector<pathstore::IndexEntry> index;    // The index of the records written so far.
+	std::vector<std::vector<int32_t>> lastPaths; // The last path written for each OD-pair.
+	std::vector<bool> hasLastPath;               // Has a path been written for each OD-pair?
+	std::vector<uint8_t> record;                 // The encoded record of the current iteration.
+	std::vector<int32_t> path;                   // The current path, with original edge IDs.
+};
+
+// Reads the records of a binary path store.
+class PathStoreReader {
+public:
+	// Opens the specified path store and reads its header, row mapping and index.
+	explicit PathStoreReader(const std::string& filename) : in(filename, std::ios::binary) {
+		pathstore::Header header;
+		in.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!in.good() || std::memcmp(header.magic, pathstore::magic(), sizeof(header.magic)) != 0 ||
+			header.version != pathstore::VERSION || header.numPairs < 0 || header.numRows < 0)
+			throw std::invalid_argument("invalid or incompatible path store -- '" + filename + "'");
+		changedOnly = header.flags & pathstore::CHANGED_ONLY;
+		pairs = header.numPairs;
+		pairOfRows.resize(header.numRows);
+		in.read(reinterpret_cast<char*>(pairOfRows.data()), pairOfRows.size() * sizeof(int32_t));
+
+		pathstore::Footer footer;
+		in.seekg(-static_cast<int64_t>(sizeof(footer)), std::ios::end);
+		in.read(reinterpret_cast<char*>(&footer), sizeof(footer));
+		if (!in.good() || std::memcmp(footer.magic, pathstore::magic(), sizeof(footer.magic)) != 0)
+			throw std::invalid_argument("truncated path store -- '" + filename + "'");
+		index.resize(footer.numIterations);
+		in.seekg(footer.indexOffset);
+		in.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(pathstore::IndexEntry));
+		if (!in.good())
+			throw std::invalid_argument("truncated path store -- '" + filename + "'");
+	}
+
+	// Returns the number of iteration records.
+	int numRecords() const {
+		return index.size();
+	}
+
+	// Returns the Frank-Wolfe iteration of the k-th record.
+	int iteration(const int k) const {
+		assert(k >= 0); assert(k < numRecords());
+		return index[k].iteration;
+	}
+
+	// Returns the number of OD-pairs.
+	int numPairs() const {
+		return pairs;
+	}
+
+	// Returns the number of input rows of OD-pairs.
+	int numRows() const {
+		return pairOfRows.size();
+	}
+
+	// Returns the OD-pair into which the specified input row was aggregated.
+	int pairOfRow(const int row) const {
+		assert(row >= 0); assert(row < numRows());
+		return pairOfRows[row];
+	}
+
+	// Returns true if each record holds only the paths that changed.
+	bool isChangedOnly() const {
+		return changedOnly;
+	}
+
+	// Overwrites the paths stored in the k-th record. Applying records 0 to k in turn yields the
+	// paths of all OD-pairs in the k-th record's iteration (in changed-only mode, too).
+	void applyRecord(const int k, std::vector<std::vector<int>>& paths) {
+		assert(k >= 0); assert(k < numRecords());
+		paths.resize(pairs);
+		record.resize(index[k].size);
+		in.seekg(index[k].offset);
+		in.read(reinterpret_cast<char*>(record.data()), record.size());
+		if (!in.good())
+			throw std::invalid_argument("truncated path store record");
+
+		size_t pos = 0;
+		int64_t pair = -1;
+		for (int j = 0; j < index[k].numPaths; ++j)
+		{
+			pair += pathstore::readVarint(record, pos) + 1;
+			if (pair >= pairs)
+				throw std::invalid_argument("corrupt path store record");
+			std::vector<int>& path = paths[pair];
+			path.resize(pathstore::readVarint(record, pos));
+			int64_t edge = 0;
+			for (auto& e : path)
+			{
+				edge += pathstore::unzigzag(pathstore::readVarint(record, pos));
+				e = edge;
+			}
+		}
+	}
+
+private:
+	std::ifstream in;                         // The input file.
+	bool changedOnly = false;                 // Does each record hold only the changed paths?
+	int pairs = 0;                            // The number of OD-pairs.
+	std::vector<int32_t> pairOfRows;          // The OD-pair of each input row.
+	std::vector<pathstore::IndexEntry> index; // The index of the records.
+	std::vector<uint8_t> record;              // The bytes of the current record.
+};
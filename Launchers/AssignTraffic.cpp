@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <random>
@@ -14,51 +15,96 @@
 #include <sys/types.h> 
 
 #include <boost/dynamic_bitset.hpp>
+#include <omp.h>
 #include <routingkit/customizable_contraction_hierarchy.h>
 #include <routingkit/nested_dissection.h>
 
+#include "Algorithms/TrafficAssignment/Adapters/ALTAdapter.h"
 #include "Algorithms/TrafficAssignment/Adapters/DijkstraAdapter.h"
+#include "Algorithms/TrafficAssignment/Adapters/DynamicTreeAdapter.h"
 #include "Algorithms/TrafficAssignment/Adapters/ConstrainedAdapter.h"
 #include "Algorithms/TrafficAssignment/ObjectiveFunctions/SystemOptimum.h"
 #include "Algorithms/TrafficAssignment/ObjectiveFunctions/UserEquilibrium.h"
 #include "Algorithms/TrafficAssignment/ObjectiveFunctions/CombinedEquilibrium.h"
+#include "Algorithms/TrafficAssignment/TravelCostFunctions/ApproxBprFunction.h"
 #include "Algorithms/TrafficAssignment/TravelCostFunctions/BprFunction.h"
+#include "Algorithms/TrafficAssignment/TravelCostFunctions/CustomBprFunction.h"
 #include "Algorithms/TrafficAssignment/TravelCostFunctions/ModifiedBprFunction.h"
+#include "Algorithms/TrafficAssignment/TravelCostFunctions/UnawareBprFunction.h"
 #include "Algorithms/TrafficAssignment/FrankWolfeAssignment.h"
 #include "DataStructures/Graph/Graph.h"
-#include "DataStructures/Utilities/OriginDestination.h"
+#include "DataStructures/Utilities/FlowStore.h"
+#include "DataStructures/Utilities/OriginDestinationPairs.h"
+#include "DataStructures/Utilities/PathStore.h"
+#include "Stats/TrafficAssignment/FrankWolfeAssignmentStats.h"
 #include "Tools/CommandLine/CommandLineParser.h"
 #include "Tools/Timer.h"
 
 void printUsage() {
 	std::cout <<
-		"Usage: AssignTraffic [-obj <objective>] [-f <func>] [-a <algo>] [-n <num>] [-ce <num>] -i <file> -od <file> [-o <path>]  \n"
+		"Usage: AssignTraffic [-obj <objective>] [-f <func>] [-a <algo>] [-n <num>] [-ce <num>] -i <file> (-od <file>... | -periods <file>...) [-o <path>]  \n"
 		"This program assigns OD-pairs onto a network using the Frank-Wolfe method. It\n"
 		"supports different objectives, travel cost functions and shortest-path algos.\n"
 		"  -obj	<objective>		objective function:\n"
 		"							sys_opt (default), user_eq, combined_eq\n"
 		"  -f <func>			travel cost function:\n"
-		"							bpr (default) modified_bpr\n"
+		"							bpr (default) modified_bpr custom_bpr\n"
+		"							approx_bpr unaware_bpr\n"
 		"  -a <algo>			shortest-path algorithm:\n"
-		"							dijkstra (default) constrained\n"
+		"							dijkstra (default) constrained alt dynamic\n"
 		"  -n <num>				number of iterations (default = 100)\n"
 		"  -ce_param <num>		combined_eq interpolation parameter in [0,1]:\n"
 		"						0 for UE, 1 for SO\n"
-		"  -const_param <num>	distance multiplier for constrained search"
-		"  -elastic				flag for elastic demand with rebalancing"
-		"  -i <path>			input graph edge CSV file\n"
-		"  -od <file>			OD-pair file\n"
+		"  -const_param <num>	distance multiplier for constrained search\n"
+		"  -landmarks <num>		number of landmarks for alt search (default = 16)\n"
+		"  -tree_mem <num>		memory in MiB for trees kept by dynamic search (default = 1024)\n"
+		"  -reorder <order>		renumber vertices at load time for locality:\n"
+		"							none (default) dfs bfs\n"
+		"  -aggregate			merge identical OD rows by summing their volumes\n"
+		"  -flow_every <num>		write edge flows and costs every num iterations\n"
+		"						(and after the last) to flows.bin\n"
+		"  -path_flows			write the path-flow decomposition of the final solution\n"
+		"  -paths <format>		format of the per-iteration path output:\n"
+		"							csv (default) binary changed none\n"
+		"  -elastic				flag for elastic demand with rebalancing\n"
+		"  -batched				route all elastic queries in one pass per iteration\n"
+		"  -lazy <tol>			keep OD paths within relative tolerance of optimal\n"
+		"						without a search (classic assignment only)\n"
+		"  -i <path>			input graph edge CSV file or binary snapshot\n"
+		"  -od <file>...			OD-pair CSV file or binary OD file for each user class\n"
+		"  -pce <num>...			passenger car equivalent of each user class (default = 1)\n"
+		"  -periods <file>...		solve one period per OD-pair file in parallel, sharing the\n"
+		"						loaded graph (outputs in <path>/period_<k>)\n"
 		"  -o <path>			output path\n"
 		"  -v					display informative messages\n"
 		"  -help				display this help and exit\n";  
 }
 
 
+// The outcome of assigning the OD-flows of one period.
+struct AssignmentSummary {
+	int preprocessingTime = 0;       // The time spent on preprocessing.
+	int assignmentTime = 0;          // The time spent on the Frank-Wolfe iterations.
+	FrankWolfeAssignmentStats stats; // The statistics after the last iteration.
+};
+
 // Assigns all OD-flows onto the input graph.
 template <typename FrankWolfeAssignmentT>
 void assignTraffic(const CommandLineParser& clp) {
 	const std::string infilename = clp.getValue<std::string>("i");
-	const std::string odFilename = clp.getValue<std::string>("od");
+	const std::vector<std::string> odFilenames = clp.getValues<std::string>("od");
+	const std::vector<std::string> periodFilenames = clp.getValues<std::string>("periods");
+	if (clp.isSet("periods"))
+	{
+		if (periodFilenames[0].empty())
+			throw std::invalid_argument("no OD-pair file specified for the periods");
+		if (clp.isSet("od") || clp.isSet("pce"))
+			throw std::invalid_argument("user classes are not supported in multi-period mode");
+	}
+	else if (odFilenames.empty() || odFilenames[0].empty())
+	{
+		throw std::invalid_argument("no OD-pair file specified");
+	}
 	const std::string outputPath = clp.getValue<std::string>("o");
 
 	const double ceParameter = clp.getValue<double>("ce_param", 0.0);
@@ -75,94 +121,295 @@ void assignTraffic(const CommandLineParser& clp) {
 		throw std::invalid_argument(msg + " -- " + std::to_string(constParameter));
 	}
 	
+	const int numLandmarks = clp.getValue<int>("landmarks", 16);
+	if (numLandmarks < 0)
+	{
+		const std::string msg("negative number of landmarks");
+		throw std::invalid_argument(msg + " -- " + std::to_string(numLandmarks));
+	}
 	
-	Graph graph(infilename, ceParameter, constParameter);
-
-	mkdir(&outputPath[0],0777); // create output folder
+	const int treeMemoryLimit = clp.getValue<int>("tree_mem", 1024);
+	if (treeMemoryLimit < 0)
+	{
+		const std::string msg("negative tree memory limit");
+		throw std::invalid_argument(msg + " -- " + std::to_string(treeMemoryLimit));
+	}
+	
+	const double lazyTolerance = clp.getValue<double>("lazy", -1.0);
+	if (clp.isSet("lazy") && lazyTolerance < 0)
+	{
+		const std::string msg("negative lazy rerouting tolerance");
+		throw std::invalid_argument(msg + " -- " + std::to_string(lazyTolerance));
+	}
 	
-	const std::string patternFilename = outputPath + "/flow";
-	const std::string pathFilename = outputPath + "/paths";
-	const std::string weightFilename = outputPath + "/weights";
-	const std::string csvFilename = outputPath + "/output";
+	const std::string order = clp.getValue<std::string>("reorder", "none");
+	Graph::VertexOrder vertexOrder;
+	if (order == "none")
+		vertexOrder = Graph::ORIGINAL_ORDER;
+	else if (order == "dfs")
+		vertexOrder = Graph::DFS_ORDER;
+	else if (order == "bfs")
+		vertexOrder = Graph::BFS_ORDER;
+	else
+		throw std::invalid_argument("unrecognized vertex order -- '" + order + "'");
+	
+	const int flowInterval = clp.getValue<int>("flow_every", 0);
+	if (clp.isSet("flow_every") && flowInterval <= 0)
+	{
+		const std::string msg("flow snapshot interval must be positive");
+		throw std::invalid_argument(msg + " -- " + std::to_string(flowInterval));
+	}
+	
+	std::vector<double> pceOfClass = clp.getValues<double>("pce");
+	if (!clp.isSet("pce"))
+		pceOfClass.assign(odFilenames.size(), 1.0);
+	if (pceOfClass.size() != odFilenames.size())
+		throw std::invalid_argument("number of PCEs differs from number of OD-pair files");
+	for (const double pce : pceOfClass)
+		if (pce <= 0)
+			throw std::invalid_argument("passenger car equivalent must be positive -- " + std::to_string(pce));
+	
+	const std::string pathFormat = clp.getValue<std::string>("paths", "csv");
+	if (pathFormat != "csv" && pathFormat != "binary" && pathFormat != "changed" && pathFormat != "none")
+		throw std::invalid_argument("unrecognized path format -- '" + pathFormat + "'");
 	
-	std::vector<ClusteredOriginDestination> odPairs = importClusteredODPairsFrom(odFilename);
-
 	const int numIterations = clp.getValue<int>("n");
 	if (numIterations < 0) {
 		const std::string msg("negative number of iterations");
 		throw std::invalid_argument(msg + " -- " + std::to_string(numIterations));
 	}
 	
-	std::ofstream csv;
-	if (!csvFilename.empty()) {
-		csv.open(csvFilename + ".csv");
-		if (!csv.good())
-			throw std::invalid_argument("file cannot be opened -- '" + csvFilename + ".csv'");
-		csv << "# Input graph: " << infilename << "\n";
-		csv << "# OD-pairs: " << odFilename << "\n";
-
-		const std::string objectiveFunction = clp.getValue<std::string>("obj", "sys_opt");
+	using ShortestPathPreprocessing = typename FrankWolfeAssignmentT::ShortestPathPreprocessing;
+	int sharedPreprocessingTime = 0;
+
+	// Assigns the OD-flows of the user classes in the specified files onto the graph, routing on the
+	// specified weights, and writes the outputs to the specified path.
+	const auto assignDemand = [&](const Graph& graph, std::vector<EdgeValue>& weights,
+								  const ShortestPathPreprocessing& preprocessing, const std::vector<std::string>& odFilenames,
+								  const std::vector<double>& pceOfClass, const std::string& outputPath,
+								  const bool verbose) {
+		mkdir(&outputPath[0],0777); // create output folder
 		
-		if (objectiveFunction == "combined_eq")
-			csv << "# Objective: " << objectiveFunction << "(" << ceParameter << ")\n";
-		else 
-			csv << "# Objective: " << objectiveFunction << "\n";
+		const std::string patternFilename = outputPath + "/flow";
+		const std::string pathFilename = outputPath + "/paths";
+		const std::string weightFilename = outputPath + "/weights";
+		const std::string pathFlowFilename = outputPath + "/pathflows";
+		const std::string flowStoreFilename = outputPath + "/flows";
+		const std::string csvFilename = outputPath + "/output";
+	
+		// Each user class has its own OD-pairs, which are aggregated separately.
+		std::vector<OriginDestinationPairs> odPairsOfClass;
+		for (const auto& odFilename : odFilenames)
+		{
+			odPairsOfClass.emplace_back(odFilename, clp.isSet("elastic"));
+			OriginDestinationPairs& classPairs = odPairsOfClass.back();
+			if (clp.isSet("aggregate"))
+			{
+				classPairs.aggregate();
+				if (verbose)
+					std::cout << "Aggregated " << classPairs.numRows() << " OD rows into " << classPairs.size() << " OD-pairs (factor " << (double) classPairs.numRows() / std::max(classPairs.size(), 1) << ")" << std::endl;
+			}
+
+			// Translate the vertex and edge IDs in the OD-pairs to the (possibly reordered) graph.
+			classPairs.relabel([&](const int v) { return graph.vertexId(v); }, [&](const int e) { return graph.edgeId(e); });
+		}
+
+		// The OD-pairs and input rows of all classes, class after class.
+		OriginDestinationPairs allOdPairs(clp.isSet("elastic"));
+		if (odPairsOfClass.size() > 1)
+			for (const auto& classPairs : odPairsOfClass)
+				allOdPairs.append(classPairs);
+		const OriginDestinationPairs& odPairs = odPairsOfClass.size() > 1 ? allOdPairs : odPairsOfClass[0];
+
+		std::ofstream csv;
+		if (!csvFilename.empty()) {
+			csv.open(csvFilename + ".csv");
+			if (!csv.good())
+				throw std::invalid_argument("file cannot be opened -- '" + csvFilename + ".csv'");
+			csv << "# Input graph: " << infilename << (Graph::isSnapshot(infilename) ? " (snapshot)" : "") << "\n";
+			for (int c = 0; c < odFilenames.size(); ++c)
+			{
+				const std::string& odFilename = odFilenames[c];
+				csv << "# OD-pairs: " << odFilename << (OriginDestinationPairs::isBinary(odFilename) ? " (binary)" : "");
+				if (odFilenames.size() > 1)
+					csv << " (class " << c + 1 << ", PCE " << pceOfClass[c] << ")";
+				csv << "\n";
+			}
+
+			const std::string objectiveFunction = clp.getValue<std::string>("obj", "sys_opt");
 		
-		csv << "# Function: " << clp.getValue<std::string>("f", "bpr") << "\n";
+			if (objectiveFunction == "combined_eq")
+				csv << "# Objective: " << objectiveFunction << "(" << ceParameter << ")\n";
+			else 
+				csv << "# Objective: " << objectiveFunction << "\n";
+		
+			csv << "# Function: " << clp.getValue<std::string>("f", "bpr") << "\n";
 
-		const std::string algorithm = clp.getValue<std::string>("a", "dijkstra");
-		if (algorithm == "constrained")
-			csv << "# Shortest-path algo: " << algorithm  << "(" << constParameter << ")\n";
-		else
-			csv << "# Shortest-path algo: " << algorithm << "\n";
-		csv << std::flush;
-	}
+			const std::string algorithm = clp.getValue<std::string>("a", "dijkstra");
+			if (algorithm == "constrained")
+				csv << "# Shortest-path algo: " << algorithm  << "(" << constParameter << ")\n";
+			else if (algorithm == "alt")
+				csv << "# Shortest-path algo: " << algorithm  << "(" << numLandmarks << ")\n";
+			else if (algorithm == "dynamic")
+				csv << "# Shortest-path algo: " << algorithm  << "(" << treeMemoryLimit << "MiB)\n";
+			else
+				csv << "# Shortest-path algo: " << algorithm << "\n";
+			if (clp.isSet("aggregate"))
+				csv << "# OD aggregation: " << odPairs.numRows() << " rows into " << odPairs.size() << " pairs (factor " << (double) odPairs.numRows() / std::max(odPairs.size(), 1) << ")\n";
+			if (vertexOrder != Graph::ORIGINAL_ORDER)
+				csv << "# Vertex order: " << order << "\n";
+			if (clp.isSet("flow_every"))
+				csv << "# Flow snapshot interval: " << flowInterval << "\n";
+			if (pathFormat != "csv")
+				csv << "# Path format: " << pathFormat << "\n";
+			if (clp.isSet("lazy"))
+				csv << "# Lazy rerouting tolerance: " << lazyTolerance << "\n";
+			csv << std::flush;
+		}
 	
-	std::ofstream patternFile;
-	if (!patternFilename.empty()) {
-		patternFile.open(patternFilename + ".csv");
-		if (!patternFile.good())
-			throw std::invalid_argument("file cannot be opened -- '" + patternFilename + ".csv'");
-		if (!csvFilename.empty())
-			patternFile << "# Main file: " << csvFilename << ".csv\n";
-		patternFile << "numIteration,tail,head,freeFlowCost,actualCost,capacity,flow\n";
-	}
+		std::ofstream patternFile;
+		if (!patternFilename.empty()) {
+			patternFile.open(patternFilename + ".csv");
+			if (!patternFile.good())
+				throw std::invalid_argument("file cannot be opened -- '" + patternFilename + ".csv'");
+			if (!csvFilename.empty())
+				patternFile << "# Main file: " << csvFilename << ".csv\n";
+			patternFile << "numIteration,tail,head,freeFlowCost,actualCost,capacity,flow";
+			if (odFilenames.size() > 1)
+				for (int c = 0; c < odFilenames.size(); ++c)
+					patternFile << ",flow_" << c + 1;
+			patternFile << "\n";
+		}
 
-	std::ofstream pathFile;
-	if (!pathFilename.empty()) {
-		pathFile.open(pathFilename + ".csv");
-		if (!pathFile.good())
-			throw std::invalid_argument("file cannot be opened -- '" + pathFilename + ".csv'");
-		if (!csvFilename.empty())
-			pathFile << "# Main file: " << csvFilename << ".csv\n";
-		pathFile << "numIteration,odPair,edges\n";
-	}
+		std::ofstream pathFile;
+		if (!pathFilename.empty() && pathFormat == "csv") {
+			pathFile.open(pathFilename + ".csv");
+			if (!pathFile.good())
+				throw std::invalid_argument("file cannot be opened -- '" + pathFilename + ".csv'");
+			if (!csvFilename.empty())
+				pathFile << "# Main file: " << csvFilename << ".csv\n";
+			pathFile << "numIteration,odPair,edges\n";
+		}
 
-	std::ofstream weightFile;
-	if (!weightFilename.empty()) {
-		weightFile.open(weightFilename + ".csv");
-		if (!weightFile.good())
-			throw std::invalid_argument("file cannot be opened -- '" + weightFilename + ".csv'");
-		if (!csvFilename.empty())
-			weightFile << "# Main file: " << csvFilename << ".csv\n";
-		weightFile << "numIteration,weight\n";
-	}
+		PathStoreWriter pathStore;
+		if (!pathFilename.empty() && (pathFormat == "binary" || pathFormat == "changed")) {
+			const auto pairOfRow = [&](const int row) { return odPairs.pairOfRow(row); };
+			pathStore.open(pathFilename + ".bin", odPairs.size(), odPairs.numRows(), pairOfRow, pathFormat == "changed");
+		}
+
+		std::ofstream weightFile;
+		if (!weightFilename.empty()) {
+			weightFile.open(weightFilename + ".csv");
+			if (!weightFile.good())
+				throw std::invalid_argument("file cannot be opened -- '" + weightFilename + ".csv'");
+			if (!csvFilename.empty())
+				weightFile << "# Main file: " << csvFilename << ".csv\n";
+			weightFile << "numIteration,weight\n";
+		}
+
+		FlowStoreWriter flowStore;
+		if (clp.isSet("flow_every"))
+			flowStore.open(flowStoreFilename + ".bin", graph.numEdges(), flowInterval);
+
+		std::ofstream pathFlowFile;
+		if (clp.isSet("path_flows")) {
+			pathFlowFile.open(pathFlowFilename + ".csv");
+			if (!pathFlowFile.good())
+				throw std::invalid_argument("file cannot be opened -- '" + pathFlowFilename + ".csv'");
+			if (!csvFilename.empty())
+				pathFlowFile << "# Main file: " << csvFilename << ".csv\n";
+			pathFlowFile << "origin,destination,share,flow,edges\n";
+		}
+
+		FrankWolfeAssignmentT assign(graph, weights, preprocessing, odPairs, odPairsOfClass, pceOfClass, csv, patternFile, pathFile, pathStore, flowStore, weightFile, pathFlowFile, verbose, clp.isSet("elastic"), clp.isSet("batched"), lazyTolerance);
+
+		if (csv.is_open()) {
+			csv << "# Preprocessing time: " << sharedPreprocessingTime + assign.stats.totalRunningTime << "ms\n";
+			csv << "iteration,customization_time,query_time,line_search_time,total_time,";
+			csv << "obj_function_value,total_travel_cost,relative_gap,skipped_queries,landmark_time\n";
+			csv << std::flush;
+		}
+
+		AssignmentSummary summary;
+		summary.preprocessingTime = assign.stats.totalRunningTime;
+		Timer timer;
+
+		assign.run(numIterations);
 
-	FrankWolfeAssignmentT assign(graph, odPairs, csv, patternFile, pathFile, weightFile, clp.isSet("v"), clp.isSet("elastic"));
+		summary.assignmentTime = timer.elapsed();
+		summary.stats = assign.stats;
+		if (csv.is_open())
+			csv << "Total time:," << summary.assignmentTime << std::flush; 
+		return summary;
+	};
 
-	if (csv.is_open()) {
-		csv << "# Preprocessing time: " << assign.stats.totalRunningTime << "ms\n";
-		csv << "iteration,customization_time,query_time,line_search_time,total_time,";
-		csv << "obj_function_value,total_travel_cost\n";
-		csv << std::flush;
+	Timer loadTimer;
+	Graph graph(infilename, ceParameter, constParameter, numLandmarks, treeMemoryLimit, vertexOrder);
+	const int graphLoadingTime = loadTimer.elapsed();
+
+	// The weight-independent data of the shortest-path algo is computed once and shared by all
+	// assignments on the graph.
+	Timer preprocessingTimer;
+	const ShortestPathPreprocessing preprocessing(graph, clp.isSet("elastic"), lazyTolerance);
+	sharedPreprocessingTime = preprocessingTimer.elapsed();
+	if (clp.isSet("v"))
+		std::cout << "Shared prepro: " << sharedPreprocessingTime << "ms" << std::endl;
+
+	if (periodFilenames.empty())
+	{
+		assignDemand(graph, graph.getWeights(), preprocessing, odFilenames, pceOfClass, outputPath, clp.isSet("v"));
+		return;
 	}
 
+	// Multi-period mode. The periods share the parsed graph and the preprocessing data, and are
+	// solved in parallel, each with its own edge weights (since these change during the assignment).
+	mkdir(&outputPath[0],0777); // create output folder
+	const int numPeriods = periodFilenames.size();
+	const bool parallel = numPeriods > 1 && omp_get_max_threads() > 1;
+	std::vector<AssignmentSummary> summaries(numPeriods);
+	std::exception_ptr error;
 	Timer timer;
+	#pragma omp parallel for schedule(dynamic, 1) num_threads(std::min(numPeriods, omp_get_max_threads())) if (parallel)
+	for (int k = 0; k < numPeriods; ++k)
+	{
+		try
+		{
+			std::vector<EdgeValue> periodWeights(graph.getWeights());
+			const std::string periodPath = outputPath + "/period_" + std::to_string(k + 1);
+			summaries[k] = assignDemand(graph, periodWeights, preprocessing, {periodFilenames[k]}, {1.0}, periodPath, clp.isSet("v") && !parallel);
+			if (clp.isSet("v"))
+			{
+				#pragma omp critical(periodOutput)
+				std::cout << "Period " << k + 1 << " (" << periodFilenames[k] << ") done in " << summaries[k].preprocessingTime + summaries[k].assignmentTime << "ms" << std::endl;
+			}
+		}
+		catch (...)
+		{
+			#pragma omp critical(periodError)
+			error = std::current_exception();
+		}
+	}
+	if (error)
+		std::rethrow_exception(error);
+	const int totalTime = timer.elapsed();
 
-	assign.run(numIterations);
-
-	if (csv.is_open())
-		csv << "Total time:," << timer.elapsed() << std::flush; 
+	const std::string summaryFilename = outputPath + "/periods.csv";
+	std::ofstream summaryFile(summaryFilename);
+	if (!summaryFile.good())
+		throw std::invalid_argument("file cannot be opened -- '" + summaryFilename + "'");
+	summaryFile << "# Input graph: " << infilename << (Graph::isSnapshot(infilename) ? " (snapshot)" : "") << "\n";
+	summaryFile << "# Graph loading time: " << graphLoadingTime << "ms\n";
+	summaryFile << "# Shared preprocessing time: " << sharedPreprocessingTime << "ms\n";
+	summaryFile << "period,od_file,preprocessing_time,assignment_time,obj_function_value,total_travel_cost,relative_gap\n";
+	for (int k = 0; k < numPeriods; ++k)
+	{
+		const AssignmentSummary& summary = summaries[k];
+		summaryFile << k + 1 << ',' << periodFilenames[k] << ',' << summary.preprocessingTime << ',' << summary.assignmentTime << ',';
+		summaryFile << summary.stats.objFunctionValue << ',' << summary.stats.totalTravelCost << ',' << summary.stats.relativeGap << '\n';
+	}
+	summaryFile << "Total time:," << totalTime << std::flush;
+	if (clp.isSet("v"))
+		std::cout << "Assigned " << numPeriods << " periods in " << totalTime << "ms (graph loading: " << graphLoadingTime << "ms, shared prepro: " << sharedPreprocessingTime << "ms)" << std::endl;
 }
 
 // Picks the shortest-path algorithm according to the command line options.
@@ -177,6 +424,14 @@ void chooseShortestPathAlgo(const CommandLineParser& clp) {
 		using Assignment = FrankWolfeAssignment<ObjFunctionT, TravelCostFunction, ConstrainedAdapter>;
 		assignTraffic<Assignment>(clp);
 	}
+	else if (algo == "alt") {
+		using Assignment = FrankWolfeAssignment<ObjFunctionT, TravelCostFunction, ALTAdapter>;
+		assignTraffic<Assignment>(clp);
+	}
+	else if (algo == "dynamic") {
+		using Assignment = FrankWolfeAssignment<ObjFunctionT, TravelCostFunction, DynamicTreeAdapter>;
+		assignTraffic<Assignment>(clp);
+	}
 	else {
 		throw std::invalid_argument("unrecognized shortest-path algorithm -- '" + algo + "'");
 	}
@@ -190,6 +445,12 @@ void chooseTravelCostFunction(const CommandLineParser& clp) {
 		chooseShortestPathAlgo<ObjFunctionT, BprFunction>(clp);
 	else if (func == "modified_bpr")
 		chooseShortestPathAlgo<ObjFunctionT, ModifiedBprFunction>(clp);
+	else if (func == "custom_bpr")
+		chooseShortestPathAlgo<ObjFunctionT, CustomBprFunction>(clp);
+	else if (func == "approx_bpr")
+		chooseShortestPathAlgo<ObjFunctionT, ApproxBprFunction>(clp);
+	else if (func == "unaware_bpr")
+		chooseShortestPathAlgo<ObjFunctionT, UnawareBprFunction>(clp);
 	else
 		throw std::invalid_argument("unrecognized travel cost function -- '" + func + "'");
 }
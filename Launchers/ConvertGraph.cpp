@@ -0,0 +1,49 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "DataStructures/Graph/Graph.h"
+#include "Tools/CommandLine/CommandLineParser.h"
+#include "Tools/Timer.h"
+
+void printUsage() {
+	std::cout <<
+		"Usage: ConvertGraph -i <file> -o <file>\n"
+		"This program converts an edge CSV file into a binary graph snapshot, which\n"
+		"AssignTraffic loads without parsing. Snapshots are detected automatically.\n"
+		"  -i <file>			input graph edge CSV file (or snapshot)\n"
+		"  -o <file>			output snapshot file\n"
+		"  -v					display informative messages\n"
+		"  -help				display this help and exit\n";
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		CommandLineParser clp(argc, argv);
+		if (clp.isSet("help")) {
+			printUsage();
+			return EXIT_SUCCESS;
+		}
+
+		const std::string infilename = clp.getValue<std::string>("i");
+		const std::string outfilename = clp.getValue<std::string>("o");
+		if (infilename.empty() || outfilename.empty())
+			throw std::invalid_argument("input and output file must be specified");
+
+		Timer timer;
+		const Graph graph(infilename, 0.0, 100.0);
+		if (clp.isSet("v"))
+			std::cout << "Read " << graph.numVertices() << " vertices and " << graph.numEdges() << " edges in " << timer.elapsed() << "ms\n";
+
+		timer.restart();
+		graph.writeSnapshotTo(outfilename);
+		if (clp.isSet("v"))
+			std::cout << "Wrote snapshot in " << timer.elapsed() << "ms" << std::endl;
+	} catch (std::invalid_argument& e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		std::cerr << "Try '" << argv[0] <<" -help' for more information." << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "DataStructures/Utilities/OriginDestinationPairs.h"
+#include "Tools/CommandLine/CommandLineParser.h"
+#include "Tools/Timer.h"
+
+void printUsage() {
+	std::cout <<
+		"Usage: ConvertODPairs [-elastic] -i <file> -o <file>\n"
+		"This program converts an OD-pair CSV file into a compact binary OD file, which\n"
+		"AssignTraffic loads without parsing. Binary OD files are detected automatically.\n"
+		"  -elastic				keep the rebalancer and virtual edge columns\n"
+		"  -i <file>			input OD-pair CSV file (or binary OD file)\n"
+		"  -o <file>			output binary OD file\n"
+		"  -v					display informative messages\n"
+		"  -help				display this help and exit\n";
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		CommandLineParser clp(argc, argv);
+		if (clp.isSet("help")) {
+			printUsage();
+			return EXIT_SUCCESS;
+		}
+
+		const std::string infilename = clp.getValue<std::string>("i");
+		const std::string outfilename = clp.getValue<std::string>("o");
+		if (infilename.empty() || outfilename.empty())
+			throw std::invalid_argument("input and output file must be specified");
+
+		Timer timer;
+		const OriginDestinationPairs odPairs(infilename, clp.isSet("elastic"));
+		if (clp.isSet("v"))
+			std::cout << "Read " << odPairs.size() << " OD-pairs in " << timer.elapsed() << "ms\n";
+
+		timer.restart();
+		odPairs.writeBinaryTo(outfilename);
+		if (clp.isSet("v"))
+			std::cout << "Wrote binary OD file in " << timer.elapsed() << "ms" << std::endl;
+	} catch (std::invalid_argument& e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		std::cerr << "Try '" << argv[0] <<" -help' for more information." << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DataStructures/Utilities/PathStore.h"
+#include "Tools/CommandLine/CommandLineParser.h"
+
+void printUsage() {
+	std::cout <<
+		"Usage: ExportPaths -i <file> -o <file> [-iter <num>...] [-od <num>...]\n"
+		"This program exports paths from a binary path store written by AssignTraffic\n"
+		"into the CSV format of paths.csv. By default, all iterations and OD rows are\n"
+		"exported.\n"
+		"  -i <file>			input binary path store\n"
+		"  -o <file>			output CSV file\n"
+		"  -iter <num>...		iterations to be exported\n"
+		"  -od <num>...			OD rows (in the order of the input OD file) to be exported\n"
+		"  -help				display this help and exit\n";
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		CommandLineParser clp(argc, argv);
+		if (clp.isSet("help")) {
+			printUsage();
+			return EXIT_SUCCESS;
+		}
+
+		const std::string infilename = clp.getValue<std::string>("i");
+		const std::string outfilename = clp.getValue<std::string>("o");
+		if (infilename.empty() || outfilename.empty())
+			throw std::invalid_argument("input and output file must be specified");
+
+		PathStoreReader reader(infilename);
+		std::vector<int> iterations = clp.getValues<int>("iter");
+		std::vector<int> rows = clp.getValues<int>("od");
+		std::sort(iterations.begin(), iterations.end());
+		if (rows.empty())
+			for (int row = 0; row < reader.numRows(); ++row)
+				rows.push_back(row);
+		for (const int row : rows)
+			if (row < 0 || row >= reader.numRows())
+				throw std::invalid_argument("OD row out of range -- " + std::to_string(row));
+
+		std::ofstream out(outfilename);
+		if (!out.good())
+			throw std::invalid_argument("file cannot be opened -- '" + outfilename + "'");
+		out << "numIteration,odPair,edges\n";
+
+		// In changed-only mode, every record up to the last selected iteration must be applied.
+		std::vector<std::vector<int>> paths;
+		for (int k = 0; k < reader.numRecords(); ++k)
+		{
+			const int iteration = reader.iteration(k);
+			const bool selected = iterations.empty() ||
+				std::binary_search(iterations.begin(), iterations.end(), iteration);
+			if (!selected && !reader.isChangedOnly())
+				continue;
+			if (!iterations.empty() && iteration > iterations.back())
+				break;
+			reader.applyRecord(k, paths);
+			if (!selected)
+				continue;
+			for (const int row : rows)
+			{
+				out << iteration << ',' << row;
+				for (const int e : paths[reader.pairOfRow(row)])
+					out << ',' << e;
+				out << '\n';
+			}
+		}
+	} catch (std::invalid_argument& e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		std::cerr << "Try '" << argv[0] <<" -help' for more information." << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+// Regression test for the parent edges of the delta-stepping search on graphs with zero-weight
+// cycles. Edges of length 0 have weight 0, so the vertices 1 and 2 below are at the same distance
+// and each is a candidate parent of the other. Exits with EXIT_FAILURE (or is terminated by an
+// alarm, if getPath does not terminate) when a path is not a shortest path from the source.
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+#include <unistd.h>
+
+#include "Algorithms/TrafficAssignment/DeltaSteppingSearch.h"
+#include "DataStructures/Graph/Graph.h"
+#include "Tools/Constants.h"
+
+// Checks that path is a path from source to t whose weight is the distance of t.
+bool isShortestPath(const Graph& graph, const std::vector<EdgeValue>& weights, const DeltaSteppingSearch& search,
+					const int source, const int t, const std::list<int>& path) {
+	int v = source;
+	double weight = 0;
+	for (const int e : path)
+	{
+		if (graph.tail(e) != v)
+			return false;
+		weight += weights[e];
+		v = graph.head(e);
+	}
+	return v == t && weight == search.distanceTo(t);
+}
+
+int main() {
+	// The zero-weight edges 1 -> 2 and 2 -> 1 come first, so that they precede the edges out of the
+	// source 3 in the incoming edges of 1 and 2.
+	char filename[] = "/tmp/DeltaSteppingTestXXXXXX";
+	const int fd = mkstemp(filename);
+	if (fd == -1)
+	{
+		std::cerr << "cannot create temporary file" << std::endl;
+		return EXIT_FAILURE;
+	}
+	close(fd);
+	std::ofstream(filename) <<
+		"edge_tail,edge_head,length,capacity,speed\n"
+		"1,2,0,1000,50\n"
+		"2,1,0,1000,50\n"
+		"3,1,100,1000,50\n"
+		"3,2,100,1000,50\n"
+		"1,0,100,1000,50\n"
+		"2,0,0,1000,50\n"
+		"0,3,100,1000,50\n";
+
+	int numFailures = 0;
+	try {
+		Graph graph(filename, 0, 0);
+		std::remove(filename);
+		omp_set_num_threads(4);
+		alarm(10);
+		DeltaSteppingSearch search(graph, graph.getWeights());
+		std::list<int> path;
+		FORALL_VERTICES(graph, source)
+		{
+			search.run(source);
+			FORALL_VERTICES(graph, t)
+			{
+				search.getPath(t, path);
+				if (!isShortestPath(graph, graph.getWeights(), search, source, t, path))
+				{
+					std::cerr << "no shortest path from " << source << " to " << t << std::endl;
+					++numFailures;
+				}
+			}
+		}
+	} catch (std::invalid_argument& e) {
+		std::remove(filename);
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return numFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
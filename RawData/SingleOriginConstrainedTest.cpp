@@ -0,0 +1,57 @@
+// Regression test for the all-or-nothing assignment with a constrained search, a single origin and
+// several threads. With fewer origins than threads, the assignment must not replace the constrained
+// search by a (parallel) search for plain shortest paths. The quickest path 0 -> 1 -> 2 is twice as
+// long as the direct edge 0 -> 2, so with a normal distance multiplier of 1 the constrained path is
+// the direct edge. Exits with EXIT_FAILURE if another path is assigned.
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+
+#include <omp.h>
+#include <unistd.h>
+
+#include "Algorithms/TrafficAssignment/Adapters/ConstrainedAdapter.h"
+#include "Algorithms/TrafficAssignment/AllOrNothingAssignment.h"
+#include "DataStructures/Graph/Graph.h"
+#include "DataStructures/Utilities/OriginDestinationPairs.h"
+
+int main() {
+	char filename[] = "/tmp/SingleOriginConstrainedTestXXXXXX";
+	const int fd = mkstemp(filename);
+	if (fd == -1)
+	{
+		std::cerr << "cannot create temporary file" << std::endl;
+		return EXIT_FAILURE;
+	}
+	close(fd);
+	std::ofstream(filename) <<
+		"edge_tail,edge_head,length,capacity,speed\n"
+		"0,1,100,1000,100\n"
+		"1,2,100,1000,100\n"
+		"0,2,100,1000,10\n";
+
+	try {
+		Graph graph(filename, 0, 1.0);
+		std::remove(filename);
+		omp_set_num_threads(4);
+		OriginDestinationPairs odPairs;
+		odPairs.add(0, 2, 1);
+		const AllOrNothingAssignment<ConstrainedAdapter>::Preprocessing preprocessing(graph);
+		AllOrNothingAssignment<ConstrainedAdapter> assignment(graph, graph.getWeights(), preprocessing, odPairs, false);
+		assignment.run();
+		const std::list<int>& path = assignment.getPaths()[0];
+		if (path.size() != 1 || graph.tail(path.front()) != 0 || graph.head(path.front()) != 2)
+		{
+			std::cerr << "the constrained path 0 -> 2 was not assigned" << std::endl;
+			return EXIT_FAILURE;
+		}
+	} catch (std::invalid_argument& e) {
+		std::remove(filename);
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -12,13 +12,18 @@ struct AllOrNothingAssignmentStats {
         lastDistances(numODPairs, -1),
         maxChangeInDistances(0),
         avgChangeInDistances(0),
+        lastNumSkippedQueries(0),
+        lastAssignedCost(0),
+        lastCostLowerBound(0),
         lastCustomizationTime(0),
         lastQueryTime(0),
         lastRoutingTime(0),
+        lastLandmarkTime(0),
         totalPreprocessingTime(0),
         totalCustomizationTime(0),
         totalQueryTime(0),
         totalRoutingTime(0),
+        totalLandmarkTime(0),
         numIterations(0) {}
 
   // Resets the values from the last iteration.
@@ -26,6 +31,10 @@ struct AllOrNothingAssignmentStats {
     lastChecksum = 0;
     maxChangeInDistances = 0;
     avgChangeInDistances = 0;
+    lastNumSkippedQueries = 0;
+    lastAssignedCost = 0;
+    lastCostLowerBound = 0;
+    lastLandmarkTime = 0;
   }
 
   // Adds the values from the last iteration to the totals.
@@ -35,6 +44,7 @@ struct AllOrNothingAssignmentStats {
     totalCustomizationTime += lastCustomizationTime;
     totalQueryTime += lastQueryTime;
     totalRoutingTime += lastRoutingTime;
+    totalLandmarkTime += lastLandmarkTime;
   }
 
   int64_t lastChecksum;  // The sum of the distances computed in the last iteration.
@@ -44,14 +54,20 @@ struct AllOrNothingAssignmentStats {
   double maxChangeInDistances;    // The max change in the OD-distances between the last iterations.
   double avgChangeInDistances;    // The avg change in the OD-distances between the last iterations.
 
+  int lastNumSkippedQueries; // The number of OD-pairs that kept their path without a search.
+  double lastAssignedCost;   // The total cost of the flow assigned in the last iteration.
+  double lastCostLowerBound; // A lower bound on the total cost of an exact all-or-nothing flow.
+
   int lastCustomizationTime; // The time spent on customization in the last iteration.
   int lastQueryTime;         // The time spent on queries in the last iteration.
   int lastRoutingTime;       // The time spent on routing in the last iteration.
+  int lastLandmarkTime;      // The time spent on refreshing landmarks in the last iteration.
 
   int totalPreprocessingTime; // The total time spent on preprocessing.
   int totalCustomizationTime; // The total time spent on customization.
   int totalQueryTime;         // The total time spent on queries.
   int totalRoutingTime;       // The total time spent on routing.
+  int totalLandmarkTime;      // The total time spent on refreshing landmarks.
 
   int numIterations; // The number of iterations performed.
 };
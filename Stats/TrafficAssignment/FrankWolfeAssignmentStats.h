@@ -1,11 +1,14 @@
 #pragma once
 
+#include <limits>
+
 // Statistics about a Frank-Wolfe assignment, including times and measures of solution quality.
 struct FrankWolfeAssignmentStats {
   // Constructs a struct collecting statistics about a Frank-Wolfe assignment.
   FrankWolfeAssignmentStats()
       : objFunctionValue(0),
         totalTravelCost(0),
+        relativeGap(std::numeric_limits<double>::quiet_NaN()),
         lastLineSearchTime(0),
         lastRunningTime(0),
         totalLineSearchTime(0),
@@ -24,6 +27,7 @@ struct FrankWolfeAssignmentStats {
 
   double objFunctionValue; // The value of the objective function resulting from current edge flows.
   double totalTravelCost;  // The total travel cost resulting from current edge flows.
+  double relativeGap;      // An upper bound on the relative gap of the flows before the last move.
 
   int lastLineSearchTime; // The time spent on the line search in the last iteration.
   int lastRunningTime;    // The running time for the last iteration.
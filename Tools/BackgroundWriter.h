@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// A background thread that executes output tasks in the order in which they were posted. The
+// number of pending tasks is bounded, so that a producer running ahead of the disk blocks instead
+// of piling up snapshots in memory. With a bound of two, the producer can prepare the next snapshot
+// while the previous one is being written. An exception thrown by a task is rethrown on the
+// producer's thread by the next call to post() or wait().
+class BackgroundWriter {
+ public:
+  // Constructs a writer that allows the specified number of pending tasks.
+  explicit BackgroundWriter(const int maxPendingTasks = 2)
+      : maxPendingTasks(maxPendingTasks), worker(&BackgroundWriter::executeTasks, this) {
+    assert(maxPendingTasks > 0);
+  }
+
+  // Executes the pending tasks and stops the background thread.
+  ~BackgroundWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopRequested = true;
+    }
+    taskPosted.notify_one();
+    worker.join();
+  }
+
+  BackgroundWriter(const BackgroundWriter&) = delete;
+  BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+  // Posts a task, blocking while the maximum number of tasks is pending.
+  void post(std::function<void()> task) {
+    std::unique_lock<std::mutex> lock(mutex);
+    taskDone.wait(lock, [this] { return tasks.size() < maxPendingTasks || error; });
+    rethrowError();
+    tasks.push_back(std::move(task));
+    lock.unlock();
+    taskPosted.notify_one();
+  }
+
+  // Blocks until all posted tasks have been executed.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    taskDone.wait(lock, [this] { return (tasks.empty() && !busy) || error; });
+    rethrowError();
+  }
+
+ private:
+  // Rethrows the exception thrown by a task, if any. The mutex must be held.
+  void rethrowError() {
+    if (error) {
+      std::exception_ptr e = error;
+      error = nullptr;
+      tasks.clear();
+      std::rethrow_exception(e);
+    }
+  }
+
+  // Executes the posted tasks until the writer is destroyed.
+  void executeTasks() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      taskPosted.wait(lock, [this] { return !tasks.empty() || stopRequested; });
+      if (tasks.empty())
+        return;
+      std::function<void()> task = std::move(tasks.front());
+      tasks.pop_front();
+      busy = true;
+      lock.unlock();
+      try {
+        task();
+      } catch (...) {
+        lock.lock();
+        error = std::current_exception();
+        tasks.clear();
+        lock.unlock();
+      }
+      lock.lock();
+      busy = false;
+      taskDone.notify_all();
+    }
+  }
+
+  const int maxPendingTasks;                // The maximum number of pending tasks.
+  std::deque<std::function<void()>> tasks;  // The pending tasks, in the order of posting.
+  std::mutex mutex;                         // The mutex guarding the members below.
+  std::condition_variable taskPosted;       // Signaled when a task was posted.
+  std::condition_variable taskDone;         // Signaled when a task was executed.
+  std::exception_ptr error;                 // The exception thrown by a task, if any.
+  bool busy = false;                        // Is a task currently being executed?
+  bool stopRequested = false;               // Has the writer been destroyed?
+  std::thread worker;                       // The background thread.
+};
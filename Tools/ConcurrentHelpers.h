@@ -1,9 +1,11 @@
 #pragma once
 
-// Atomically replaces the value of the first argument with the smaller of two values.
+// Atomically replaces the value of the first argument with the smaller of two values. The generic
+// builtins are used, so that T may be any trivially copyable type, including floating-point types.
 template <typename T>
 inline void atomicFetchMin(T& a, const T& b) {
-  T expect = a;
+  T expect;
+  __atomic_load(&a, &expect, __ATOMIC_RELAXED);
   while (b < expect &&
-         !__atomic_compare_exchange_n(&a, &expect, b, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+         !__atomic_compare_exchange(&a, &expect, &b, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
 }
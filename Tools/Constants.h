@@ -21,3 +21,12 @@ constexpr int EARTH_RADIUS = 6371000;
 #ifndef TA_LOG_K
 # define TA_LOG_K 5
 #endif
+
+// The type in which traffic assignment stores flows and edge weights. Defining TA_FLOAT_FLOWS
+// stores them in single precision, which halves the memory traffic of the edge kernels. Sums over
+// the edges (such as the objective function value) are still accumulated in double precision.
+#ifdef TA_FLOAT_FLOWS
+using EdgeValue = float;
+#else
+using EdgeValue = double;
+#endif
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A multi-threaded reader for CSV files with a header line. The file is mapped into memory and
+// split into chunks on line boundaries. The rows in each chunk are first counted and then parsed in
+// parallel, so that each row can be written directly to its final position in the caller's arrays.
+// Lines starting with '#' and blank lines are skipped. Errors are reported with line numbers.
+class ParallelCsvReader {
+ public:
+  // The fields of a single row, as passed to the row handler.
+  class Row {
+   public:
+    // Returns the value of the k-th field, parsed as an integer.
+    int getInt(const int k) const {
+      const std::string field = get(k);
+      char* end;
+      errno = 0;
+      const long value = std::strtol(field.c_str(), &end, 10);
+      if (field.empty() || *end != '\0' || errno == ERANGE ||
+          value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max())
+        throw std::invalid_argument("invalid integer '" + field + "'");
+      return value;
+    }
+
+    // Returns the value of the k-th field, parsed as a floating-point number.
+    double getDouble(const int k) const {
+      const std::string field = get(k);
+      char* end;
+      const double value = std::strtod(field.c_str(), &end);
+      if (field.empty() || *end != '\0')
+        throw std::invalid_argument("invalid number '" + field + "'");
+      return value;
+    }
+
+   private:
+    friend class ParallelCsvReader;
+
+    // Returns the k-th field with surrounding blanks removed.
+    std::string get(const int k) const {
+      if (k >= fields.size())
+        throw std::invalid_argument("too few columns");
+      const char* first = fields[k].first;
+      const char* last = fields[k].second;
+      while (first != last && (*first == ' ' || *first == '\t'))
+        ++first;
+      while (last != first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+        --last;
+      return std::string(first, last);
+    }
+
+    std::vector<std::pair<const char*, const char*>> fields; // The first and past-the-end chars.
+  };
+
+  // Opens the specified CSV file, reads its header and counts the rows.
+  explicit ParallelCsvReader(const std::string& filename) : filename(filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    struct stat fileStatus;
+    if (fd == -1 || fstat(fd, &fileStatus) == -1) {
+      if (fd != -1)
+        close(fd);
+      throw std::invalid_argument("file cannot be opened -- '" + filename + "'");
+    }
+    fileSize = fileStatus.st_size;
+    file = fileSize > 0 ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (file == MAP_FAILED)
+      throw std::invalid_argument("file cannot be mapped -- '" + filename + "'");
+
+    try {
+      readHeader();
+      splitIntoChunks();
+    } catch (...) {
+      if (file != nullptr)
+        munmap(file, fileSize);
+      throw;
+    }
+  }
+
+  // Unmaps the file.
+  ~ParallelCsvReader() {
+    if (file != nullptr)
+      munmap(file, fileSize);
+  }
+
+  ParallelCsvReader(const ParallelCsvReader&) = delete;
+  ParallelCsvReader& operator=(const ParallelCsvReader&) = delete;
+
+  // Returns the number of data rows.
+  int numRows() const {
+    return firstRowOfChunk.back();
+  }
+
+  // Returns the index of the column with the specified name, or -1 if there is no such column.
+  int columnIndex(const std::string& name) const {
+    const auto it = std::find(columnNames.begin(), columnNames.end(), name);
+    return it != columnNames.end() ? it - columnNames.begin() : -1;
+  }
+
+  // Returns the index of the column with the specified name, which must exist.
+  int requiredColumnIndex(const std::string& name) const {
+    const int index = columnIndex(name);
+    if (index == -1)
+      throw std::invalid_argument(filename + ": missing column '" + name + "'");
+    return index;
+  }
+
+  // Calls handleRow(i, row) for each data row, where i is the zero-based index of the row. Rows in
+  // different chunks are handled in parallel. If parsing or handling a row throws, the error on
+  // the earliest line is rethrown with its line number after all chunks are processed.
+  template <typename RowHandlerT>
+  void forEachRow(RowHandlerT handleRow) const {
+    const int numChunks = chunkBegin.size() - 1;
+    std::vector<int64_t> errorLine(numChunks, -1);
+    std::vector<std::string> errorMessage(numChunks);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < numChunks; ++c) {
+      Row row;
+      int i = firstRowOfChunk[c];
+      int64_t line = firstLineOfChunk[c];
+      for (const char* pos = chunkBegin[c]; pos < chunkBegin[c + 1]; ++line) {
+        const char* const end = endOfLine(pos);
+        if (isDataLine(pos, end)) {
+          splitFields(pos, end, row);
+          try {
+            handleRow(i, row);
+          } catch (std::exception& e) {
+            errorLine[c] = line;
+            errorMessage[c] = e.what();
+            break;
+          }
+          ++i;
+        }
+        pos = end + 1;
+      }
+    }
+
+    for (int c = 0; c < numChunks; ++c)
+      if (errorLine[c] != -1)
+        throw std::invalid_argument(
+            filename + ":" + std::to_string(errorLine[c]) + ": " + errorMessage[c]);
+  }
+
+ private:
+  // Returns the first byte of the mapped file.
+  const char* data() const {
+    return static_cast<const char*>(file);
+  }
+
+  // Returns the position of the newline ending the line at pos (or the end of the file).
+  const char* endOfLine(const char* pos) const {
+    const char* const fileEnd = data() + fileSize;
+    const void* const newline = std::memchr(pos, '\n', fileEnd - pos);
+    return newline != nullptr ? static_cast<const char*>(newline) : fileEnd;
+  }
+
+  // Returns true if the line from first to last is neither blank nor a comment.
+  static bool isDataLine(const char* first, const char* last) {
+    while (first != last && (*first == ' ' || *first == '\t' || *first == '\r'))
+      ++first;
+    return first != last && *first != '#';
+  }
+
+  // Splits the line from first to last into comma-separated fields.
+  static void splitFields(const char* first, const char* last, Row& row) {
+    row.fields.clear();
+    for (const char* pos = first; ; ++pos) {
+      if (pos == last || *pos == ',') {
+        row.fields.emplace_back(first, pos);
+        first = pos + 1;
+        if (pos == last)
+          break;
+      }
+    }
+  }
+
+  // Reads the column names from the first data line.
+  void readHeader() {
+    const char* pos = data();
+    const char* const fileEnd = data() + fileSize;
+    headerLine = 1;
+    while (pos < fileEnd && !isDataLine(pos, endOfLine(pos))) {
+      pos = endOfLine(pos) + 1;
+      ++headerLine;
+    }
+    if (pos >= fileEnd)
+      throw std::invalid_argument(filename + ": missing header");
+
+    Row header;
+    splitFields(pos, endOfLine(pos), header);
+    for (int k = 0; k < header.fields.size(); ++k)
+      columnNames.push_back(header.get(k));
+    dataBegin = std::min(endOfLine(pos) + 1, fileEnd);
+  }
+
+  // Splits the data lines into chunks on line boundaries and counts the lines and rows in each.
+  void splitIntoChunks() {
+    const char* const fileEnd = data() + fileSize;
+    const int numChunks = std::max<int64_t>(1, std::min<int64_t>(4 * omp_get_max_threads(), (fileEnd - dataBegin) / 4096));
+    chunkBegin.assign(1, dataBegin);
+    for (int c = 1; c < numChunks; ++c) {
+      const char* pos = dataBegin + (fileEnd - dataBegin) * c / numChunks;
+      pos = std::max(pos, chunkBegin.back());
+      if (pos != dataBegin && pos < fileEnd && pos[-1] != '\n')
+        pos = std::min(endOfLine(pos) + 1, fileEnd);
+      chunkBegin.push_back(pos);
+    }
+    chunkBegin.push_back(fileEnd);
+
+    std::vector<int> numRowsInChunk(numChunks, 0);
+    std::vector<int64_t> numLinesInChunk(numChunks, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < numChunks; ++c)
+      for (const char* pos = chunkBegin[c]; pos < chunkBegin[c + 1]; ++numLinesInChunk[c]) {
+        const char* const end = endOfLine(pos);
+        numRowsInChunk[c] += isDataLine(pos, end);
+        pos = end + 1;
+      }
+
+    firstRowOfChunk.assign(1, 0);
+    firstLineOfChunk.assign(1, headerLine + 1);
+    for (int c = 0; c < numChunks; ++c) {
+      firstRowOfChunk.push_back(firstRowOfChunk.back() + numRowsInChunk[c]);
+      firstLineOfChunk.push_back(firstLineOfChunk.back() + numLinesInChunk[c]);
+    }
+  }
+
+  const std::string filename;            // The name of the CSV file.
+  void* file = nullptr;                  // The mapped file.
+  uint64_t fileSize = 0;                 // The size of the file in bytes.
+  int64_t headerLine = 0;                // The line number of the header.
+  const char* dataBegin = nullptr;       // The first byte after the header.
+  std::vector<std::string> columnNames;  // The names of the columns.
+  std::vector<const char*> chunkBegin;   // The first byte of each chunk, plus the end of the file.
+  std::vector<int> firstRowOfChunk;      // The index of the first row in each chunk, plus the total.
+  std::vector<int64_t> firstLineOfChunk; // The line number of the first line in each chunk.
+};
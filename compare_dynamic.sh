@@ -0,0 +1,35 @@
+#!/bin/bash
+#set -x #echo on
+# Compares the shortest-path algo dynamic, which repairs the shortest-path tree of each origin from
+# the last iteration, with rebuilding all trees from scratch (dynamic with -tree_mem 0, which stores
+# no trees). For each instance, prints the total query time of the first ten and of the remaining
+# iterations for both.
+#
+# Usage: compare_dynamic.sh <instance>..., where each instance is a directory containing the files
+# edges.csv and od.csv.
+
+results=../Differential_Pricing/Results/dynamic/
+exe=Build/Release/Launchers/AssignTraffic
+iterations=30
+
+if [ $# -eq 0 ]
+then
+	echo "usage: $0 <instance>..."
+	exit 1
+fi
+
+mkdir -p $results
+scons -Q variant=Release && cp $exe $results/AssignTraffic || exit 1
+
+for instance in "$@"
+do
+	name=$(basename $instance)
+	$results/AssignTraffic -n $iterations -a dynamic -tree_mem 0 -i $instance/edges.csv -od $instance/od.csv -o $results/$name-scratch > /dev/null
+	$results/AssignTraffic -n $iterations -a dynamic -i $instance/edges.csv -od $instance/od.csv -o $results/$name-repair > /dev/null
+	echo "$name (query time in ms, iterations 1-10 / 11-$iterations):"
+	for mode in scratch repair
+	do
+		echo -n "  $mode: "
+		awk -F, '$1 ~ /^[0-9]+$/ { if ($1 <= 10) first += $3; else rest += $3 } END { print first " / " rest }' $results/$name-$mode/output.csv
+	done
+done
@@ -0,0 +1,44 @@
+#!/bin/bash
+#set -x #echo on
+# Compares the default build of AssignTraffic with a build storing flows and edge weights in single
+# precision (def=TA_FLOAT_FLOWS). For each instance and objective, prints the objective function
+# value and the relative gap after the last iteration for both builds, and the largest difference
+# of an edge flow between them.
+#
+# Usage: compare_precision.sh <instance>..., where each instance is a directory containing the files
+# edges.csv and od.csv.
+
+results=../Differential_Pricing/Results/precision/
+exe=Build/Release/Launchers/AssignTraffic
+iterations=100
+
+if [ $# -eq 0 ]
+then
+	echo "usage: $0 <instance>..."
+	exit 1
+fi
+
+mkdir -p $results
+scons -Q variant=Release && cp $exe $results/AssignTraffic-double || exit 1
+scons -Q variant=Release def=TA_FLOAT_FLOWS && cp $exe $results/AssignTraffic-float || exit 1
+
+for instance in "$@"
+do
+	name=$(basename $instance)
+	for obj in sys_opt user_eq
+	do
+		for precision in double float
+		do
+			$results/AssignTraffic-$precision -n $iterations -obj $obj -i $instance/edges.csv -od $instance/od.csv -o $results/$name-$obj-$precision > /dev/null
+		done
+		echo "$name $obj (iteration, objective, relative gap):"
+		for precision in double float
+		do
+			echo -n "  $precision: "
+			awk -F, -v n=$iterations '$1 == n { print $1 ", " $6 ", " $8 }' $results/$name-$obj-$precision/output.csv
+		done
+		echo -n "  max flow difference: "
+		paste -d, $results/$name-$obj-double/flow.csv $results/$name-$obj-float/flow.csv |
+			awk -F, '$1 ~ /^[0-9]+$/ { d = $7 - $14; if (d < 0) d = -d; if (d > max) max = d } END { print max + 0 }'
+	done
+done